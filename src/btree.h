@@ -11,11 +11,14 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <iterator>
 #include <vector>
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "latch.h"
+#include <mutex>
 #include <unordered_map>
 #define ORDER 2
 
@@ -28,7 +31,12 @@ enum Datatype
 {
 	INTEGER = 0,
 	DOUBLE = 1,
-	STRING = 2
+	STRING = 2,
+	VARCHAR = 3,
+	COMPOSITE = 4,
+	BIGINT = 5,
+	UNSIGNED = 6,
+	UBIGINT = 7
 };
 
 /**
@@ -47,23 +55,90 @@ enum Operator
  */
 const  int STRINGSIZE = 10;
 
+/**
+ * @brief Maximum size of VARCHAR key. Keys that are shorter end with a null character. A key given to an index
+ * is a null-terminated string, a longer one is rejected with KeyTooLongException.
+ */
+const  int VARCHARSIZE = 64;
+
+/**
+ * @brief Size of COMPOSITE key. The encoded columns of the key are stored one after the other, the rest is zero.
+ */
+const  int COMPOSITESIZE = 32;
+
+/**
+ * @brief Maximum number of columns of a COMPOSITE key.
+ */
+const  int MAXKEYCOLUMNS = 4;
+
+/**
+ * @brief Maximum number of payload columns stored next to the record ids of an index.
+ */
+const  int MAXPAYLOADCOLUMNS = 4;
+
+/**
+ * @brief Maximum size in bytes of the payload of an index entry.
+ */
+const  int MAXPAYLOADSIZE = 64;
+
+/**
+ * @brief Number of leaves the first read-ahead of a scan covers. Every further one covers twice as many leaves as
+ * the one before, up to MAXREADAHEAD.
+ */
+const  int MINREADAHEAD = 4;
+
+/**
+ * @brief Maximum number of leaves a scan reads ahead.
+ */
+const  int MAXREADAHEAD = 64;
+
 /**
  * @brief Number of key slots in B+Tree leaf for INTEGER key.
  */
-//                                                  sibling ptr             key               rid
-const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) - sizeof(int)) / ( sizeof( int ) + sizeof( RecordId ) );
+//                                                  sibling ptrs            key               rid
+const  int INTARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( sizeof( int ) + sizeof( RecordId ) );
 
 /**
  * @brief Number of key slots in B+Tree leaf for DOUBLE key.
  */
-//                                                     sibling ptr               key               rid
-const  int DOUBLEARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId )  - sizeof(int)) / ( sizeof( double ) + sizeof( RecordId ) );
+//                                                     sibling ptrs              key               rid
+const  int DOUBLEARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( sizeof( double ) + sizeof( RecordId ) );
 
 /**
  * @brief Number of key slots in B+Tree leaf for STRING key.
  */
-//                                                    sibling ptr           key                      rid
-const  int STRINGARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId )  - sizeof(int)) / ( 10 * sizeof(char) + sizeof( RecordId ) );
+//                                                    sibling ptrs          key                      rid
+const  int STRINGARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( 10 * sizeof(char) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for VARCHAR key.
+ */
+//                                                     sibling ptrs          key                           rid
+const  int VARCHARARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( VARCHARSIZE * sizeof(char) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for COMPOSITE key.
+ */
+//                                                       sibling ptrs          key                             rid
+const  int COMPOSITEARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( COMPOSITESIZE * sizeof(char) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for BIGINT key.
+ */
+//                                                     sibling ptrs                 key                   rid
+const  int BIGINTARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( sizeof( std::int64_t ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for UNSIGNED key.
+ */
+//                                                       sibling ptrs                 key                   rid
+const  int UNSIGNEDARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( sizeof( std::uint32_t ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of key slots in B+Tree leaf for UBIGINT key.
+ */
+//                                                      sibling ptrs                 key                   rid
+const  int UBIGINTARRAYLEAFSIZE = ( Page::SIZE - 2*sizeof( PageId ) - sizeof(int)) / ( sizeof( std::uint64_t ) + sizeof( RecordId ) );
 
 /**
  * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
@@ -83,6 +158,171 @@ const  int DOUBLEARRAYNONLEAFSIZE = (( Page::SIZE - 2*sizeof( int ) - sizeof( Pa
 //                                                        level        extra pageNo             key                   pageNo
 const  int STRINGARRAYNONLEAFSIZE = ( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( 10 * sizeof(char) + sizeof( PageId ) );
 
+/**
+ * @brief Number of key slots in B+Tree non-leaf for VARCHAR key.
+ */
+//                                                         level        extra pageNo                  key                     pageNo
+const  int VARCHARARRAYNONLEAFSIZE = ( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( VARCHARSIZE * sizeof(char) + sizeof( PageId ) );
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for COMPOSITE key.
+ */
+//                                                           level        extra pageNo                    key                       pageNo
+const  int COMPOSITEARRAYNONLEAFSIZE = ( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( COMPOSITESIZE * sizeof(char) + sizeof( PageId ) );
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for BIGINT key.
+ */
+//                                                        level        extra pageNo                    key                  pageNo   -1 due to structure padding
+const  int BIGINTARRAYNONLEAFSIZE = (( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( sizeof( std::int64_t ) + sizeof( PageId ) )) - 1;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for UNSIGNED key.
+ */
+//                                                          level     extra pageNo                     key                  pageNo
+const  int UNSIGNEDARRAYNONLEAFSIZE = ( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( sizeof( std::uint32_t ) + sizeof( PageId ) );
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for UBIGINT key.
+ */
+//                                                         level        extra pageNo                     key                  pageNo   -1 due to structure padding
+const  int UBIGINTARRAYNONLEAFSIZE = (( Page::SIZE - 2*sizeof( int ) - sizeof( PageId ) ) / ( sizeof( std::uint64_t ) + sizeof( PageId ) )) - 1;
+
+/**
+ * @brief Fixed width character key of SIZE bytes. Wraps the char array of a STRING or VARCHAR key so that it can
+ * be copied, compared and sorted like the INTEGER and DOUBLE keys.
+ */
+template <int SIZE>
+struct CharKey{
+	char data[ SIZE ];
+};
+
+typedef CharKey<STRINGSIZE> StringKey;
+typedef CharKey<VARCHARSIZE> VarcharKey;
+typedef CharKey<COMPOSITESIZE> CompositeKey;
+
+/**
+ * @brief Compare two keys of SIZE bytes as unsigned bytes, with the result of memcmp. The keys are compared
+ * 8 bytes at a time as big-endian integers, so keys that differ in their first 8 bytes take a single
+ * integer compare, and only the last SIZE % 8 bytes go through memcmp.
+ */
+template <int SIZE>
+inline int compareKeyBytes( const char* k1, const char* k2 )
+{
+	int i = 0;
+	for( ; i + 8 <= SIZE; i += 8 )
+	{
+		std::uint64_t w1, w2;
+		memcpy( &w1, k1 + i, 8 );
+		memcpy( &w2, k2 + i, 8 );
+		if( w1 != w2 )
+		{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			w1 = __builtin_bswap64( w1 );
+			w2 = __builtin_bswap64( w2 );
+#endif
+			return w1 < w2 ? -1 : 1;
+		}
+	}
+	return memcmp( k1 + i, k2 + i, SIZE - i );
+}
+
+/**
+ * @brief Overloaded operators to compare two character keys over all their SIZE characters.
+ * Keys are zero padded after their first null character, so a byte compare orders them like strncmp
+ * without testing every byte for the terminator.
+ */
+template <int SIZE>
+inline bool operator<( const CharKey<SIZE>& k1, const CharKey<SIZE>& k2 )
+{
+	return compareKeyBytes<SIZE>( k1.data, k2.data ) < 0;
+}
+
+template <int SIZE>
+inline bool operator!=( const CharKey<SIZE>& k1, const CharKey<SIZE>& k2 )
+{
+	return memcmp( k1.data, k2.data, SIZE ) != 0;
+}
+
+/**
+ * @brief A fixed width attribute stored next to the record id of every index entry, so that scans can return it
+ * without reading the record.
+ */
+struct PayloadColumn{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Size of the attribute in bytes.
+   */
+	int size;
+};
+
+/**
+ * @brief Options used when the index is built from the base relation. Passed to the BTreeIndex constructor.
+ */
+struct IndexBuildOptions{
+  /**
+   * Fraction of the key slots of every leaf and non-leaf page filled by the bulk loader.
+   * Values below 1 leave free slots so that later inserts do not split right away.
+   */
+	double fillFactor;
+
+  /**
+   * Memory budget, in pages, of the sort of the <key, rid> pairs. Larger inputs are sorted externally:
+   * sorted runs are spilled to a temporary file and merged. At most this many pages of the temporary
+   * file are kept in the buffer pool.
+   */
+	std::uint32_t sortMemPages;
+
+  /**
+   * Number of threads scanning the relation. Each thread scans a disjoint range of the pages of the relation
+   * and sorts the keys it extracted, the sorted runs are then merged into one packed tree.
+   */
+	int buildThreads;
+
+  /**
+   * Attributes stored in the leaves next to every record id, at most MAXPAYLOADCOLUMNS of MAXPAYLOADSIZE bytes
+   * together. The payload of an entry is the columns one after the other. They are kept in the meta page, an
+   * existing index has to be opened with the same columns. Leaves hold fewer entries the larger the payload is.
+   */
+	std::vector<PayloadColumn> payloadColumns;
+
+  /**
+   * Store every key once, followed by the record ids of its entries as a posting list, see PostingHead. Indexes
+   * on columns with few distinct values get much smaller, and a lookup returns the record ids of a key as one
+   * block. Not for DOUBLE and COMPOSITE keys, and cannot be combined with payload columns. Kept in the meta page.
+   */
+	bool postingLists;
+
+  /**
+   * Store the entries of an INTEGER index in packed leaves, see PackedLeaf. A leaf holds several times more
+   * entries the closer its keys are to each other, at the cost of decoding a leaf whenever it is read. Cannot be
+   * combined with payload columns or posting lists. Kept in the meta page.
+   */
+	bool packedLeaves;
+
+	IndexBuildOptions() : fillFactor( 1.0 ), sortMemPages( 1024 ), buildThreads( 1 ), postingLists( false ),
+	                      packedLeaves( false ) {}
+};
+
+/**
+ * @brief One column of a COMPOSITE key: an INTEGER, BIGINT, UNSIGNED, UBIGINT, DOUBLE or STRING attribute of the record.
+ */
+struct KeyColumn{
+  /**
+   * Offset of the attribute inside the record.
+   */
+	int attrByteOffset;
+
+  /**
+   * Type of the attribute.
+   */
+	Datatype attrType;
+};
+
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
  * add to or make changes to the leaf node pages of the tree. Is templated for the key member.
@@ -99,6 +339,16 @@ public:
 	}
 };
 
+/**
+ * @brief Key-rid pair with the payload of its record. The bulk loader sorts these for an index with payload
+ * columns, so the payloads are taken from the records while the relation is scanned.
+ */
+template <class T>
+class RIDKeyPayload : public RIDKeyPair<T> {
+public:
+	char payload[ MAXPAYLOADSIZE ];
+};
+
 /**
  * @brief Structure to store a key page pair which is used to pass the key and page to functions that make 
  * any modifications to the non leaf pages of the tree.
@@ -118,15 +368,17 @@ public:
 /**
  * @brief Overloaded operator to compare the key values of two rid-key pairs
  * and if they are the same compares to see if the first pair has
- * a smaller rid.pageNo value.
+ * a smaller rid.pageNo (then rid.slotNo) value.
 */
 template <class T>
 bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
 {
 	if( r1.key != r2.key )
 		return r1.key < r2.key;
-	else
+	else if( r1.rid.page_number != r2.rid.page_number )
 		return r1.rid.page_number < r2.rid.page_number;
+	else
+		return r1.rid.slot_number < r2.rid.slot_number;
 }
 
 /**
@@ -134,7 +386,7 @@ bool operator<( const RIDKeyPair<T>& r1, const RIDKeyPair<T>& r2 )
  * to the following structure to store or retrieve information from it.
  * Contains the relation name for which the index is created, the byte offset
  * of the key value on which the index is made, the type of the key and the page no
- * of the root page. Root page starts as page 2 but since a split can occur
+ * of the root page. The root page is written last by the bulk loader and since a split can occur
  * at the root the root page may get moved up and get a new page no.
 */
 struct IndexMetaInfo{
@@ -157,6 +409,42 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Page number of the first page of the list of pages freed by deletes, 0 if the list is empty.
+   * Each free page holds the page number of the next one in its first bytes.
+   */
+	PageId freePageNo;
+
+  /**
+   * Number of columns of a COMPOSITE key, 0 for the other types.
+   */
+	int numColumns;
+
+  /**
+   * Columns of a COMPOSITE key, in key order.
+   */
+	KeyColumn columns[ MAXKEYCOLUMNS ];
+
+  /**
+   * Number of payload columns, 0 if entries have no payload.
+   */
+	int numPayloadColumns;
+
+  /**
+   * Payload columns, in the order they are stored in.
+   */
+	PayloadColumn payloadColumns[ MAXPAYLOADCOLUMNS ];
+
+  /**
+   * True if the leaves hold posting lists, see IndexBuildOptions::postingLists.
+   */
+	bool postingLists;
+
+  /**
+   * True if the entries are kept in packed leaves, see IndexBuildOptions::packedLeaves.
+   */
+	bool packedLeaves;
 };
 
 /*
@@ -233,176 +521,500 @@ struct NonLeafNodeString{
 };
 
 /**
- * @brief Structure for all leaf nodes when the key is of INTEGER type.
+ * @brief Structure for all non-leaf nodes when the key is of VARCHAR type.
 */
-struct LeafNodeInt{
+struct NonLeafNodeVarchar{
   /**
-   * Stores keys.
+   * Level of the node in the tree.
    */
-	int keyArray[ INTARRAYLEAFSIZE ];
+	int level;
 
   /**
-   * Stores RecordIds.
+   * Stores keys.
    */
-	RecordId ridArray[ INTARRAYLEAFSIZE ];
+	char keyArray[ VARCHARARRAYNONLEAFSIZE ][ VARCHARSIZE ];
 
   int keyArrLength;
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId rightSibPageNo;
+	PageId pageNoArray[ VARCHARARRAYNONLEAFSIZE + 1 ];
 };
 
 /**
- * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+ * @brief Structure for all non-leaf nodes when the key is of COMPOSITE type.
 */
-struct LeafNodeDouble{
+struct NonLeafNodeComposite{
   /**
-   * Stores keys.
+   * Level of the node in the tree.
    */
-	double keyArray[ DOUBLEARRAYLEAFSIZE ];
+	int level;
 
   /**
-   * Stores RecordIds.
+   * Stores keys.
    */
-	RecordId ridArray[ DOUBLEARRAYLEAFSIZE ];
+	char keyArray[ COMPOSITEARRAYNONLEAFSIZE ][ COMPOSITESIZE ];
 
   int keyArrLength;
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId rightSibPageNo;
+	PageId pageNoArray[ COMPOSITEARRAYNONLEAFSIZE + 1 ];
 };
 
 /**
- * @brief Structure for all leaf nodes when the key is of STRING type.
+ * @brief Structure for all non-leaf nodes when the key is of BIGINT type.
 */
-struct LeafNodeString{
+struct NonLeafNodeBigint{
   /**
-   * Stores keys.
+   * Level of the node in the tree.
    */
-	char keyArray[ STRINGARRAYLEAFSIZE ][ STRINGSIZE ];
+	int level;
 
   /**
-   * Stores RecordIds.
+   * Stores keys.
    */
-	RecordId ridArray[ STRINGARRAYLEAFSIZE ];
+	std::int64_t keyArray[ BIGINTARRAYNONLEAFSIZE ];
 
   int keyArrLength;
 
   /**
-   * Page number of the leaf on the right side.
-	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId rightSibPageNo;
+	PageId pageNoArray[ BIGINTARRAYNONLEAFSIZE + 1 ];
 };
 
 /**
- * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
- * relation. This index supports only one scan at a time.
+ * @brief Structure for all non-leaf nodes when the key is of UNSIGNED type.
 */
-class BTreeIndex {
-
- public:
-
+struct NonLeafNodeUnsigned{
   /**
-   * File object for the index file.
+   * Level of the node in the tree.
    */
-	File		*file;
+	int level;
 
   /**
-   * Buffer Manager Instance.
+   * Stores keys.
    */
-	BufMgr	*bufMgr;
+	std::uint32_t keyArray[ UNSIGNEDARRAYNONLEAFSIZE ];
 
-  /**
-   * Page number of meta page.
-   */
-	PageId	headerPageNum;
+  int keyArrLength;
 
   /**
-   * page number of root page of B+ tree inside index file.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	PageId	rootPageNum;
+	PageId pageNoArray[ UNSIGNEDARRAYNONLEAFSIZE + 1 ];
+};
 
+/**
+ * @brief Structure for all non-leaf nodes when the key is of UBIGINT type.
+*/
+struct NonLeafNodeUbigint{
   /**
-   * Datatype of attribute over which index is built.
+   * Level of the node in the tree.
    */
-	Datatype	attributeType;
+	int level;
 
   /**
-   * Offset of attribute, over which index is built, inside records. 
+   * Stores keys.
    */
-	int 		attrByteOffset;
+	std::uint64_t keyArray[ UBIGINTARRAYNONLEAFSIZE ];
+
+  int keyArrLength;
 
   /**
-   * Number of keys in leaf node, depending upon the type of key.
+   * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
    */
-	int			leafOccupancy;
+	PageId pageNoArray[ UBIGINTARRAYNONLEAFSIZE + 1 ];
+};
 
+/**
+ * @brief Structure for all leaf nodes when the key is of INTEGER type.
+ * Keys are stored uncompressed, so every leaf operation searches and moves the plain key array. An index with
+ * IndexBuildOptions::packedLeaves keeps its entries in PackedLeaf pages instead.
+*/
+struct LeafNodeInt{
   /**
-   * Number of keys in non-leaf node, depending upon the type of key.
+   * Stores keys.
    */
-	int			nodeOccupancy;
-
-
-	// MEMBERS SPECIFIC TO SCANNING
+	int keyArray[ INTARRAYLEAFSIZE ];
 
   /**
-   * True if an index scan has been started.
+   * Stores RecordIds.
    */
-	bool		scanExecuting;
+	RecordId ridArray[ INTARRAYLEAFSIZE ];
 
+  int keyArrLength;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
-	int			nextEntry;
+	PageId rightSibPageNo;
 
   /**
-   * Page number of current page being scanned.
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
    */
-	PageId	currentPageNum;
+	PageId leftSibPageNo;
+};
 
+/**
+ * @brief Structure for all leaf nodes when the key is of DOUBLE type.
+*/
+struct LeafNodeDouble{
   /**
-   * Current Page being scanned.
+   * Stores keys.
    */
-	Page		*currentPageData;
+	double keyArray[ DOUBLEARRAYLEAFSIZE ];
 
   /**
-   * Low INTEGER value for scan.
+   * Stores RecordIds.
    */
-	int			lowValInt;
+	RecordId ridArray[ DOUBLEARRAYLEAFSIZE ];
+
+  int keyArrLength;
 
   /**
-   * Low DOUBLE value for scan.
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
-	double	lowValDouble;
+	PageId rightSibPageNo;
 
   /**
-   * Low STRING value for scan.
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
    */
-	char	lowValString[10];
+	PageId leftSibPageNo;
+};
 
+/**
+ * @brief Structure for all leaf nodes when the key is of STRING type.
+*/
+struct LeafNodeString{
   /**
-   * High INTEGER value for scan.
+   * Stores keys.
    */
-	int			highValInt;
+	char keyArray[ STRINGARRAYLEAFSIZE ][ STRINGSIZE ];
 
   /**
-   * High DOUBLE value for scan.
+   * Stores RecordIds.
    */
-	double	highValDouble;
+	RecordId ridArray[ STRINGARRAYLEAFSIZE ];
+
+  int keyArrLength;
 
   /**
-   * High STRING value for scan.
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
    */
-	char highValString[10];
-	
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of VARCHAR type.
+*/
+struct LeafNodeVarchar{
+  /**
+   * Stores keys.
+   */
+	char keyArray[ VARCHARARRAYLEAFSIZE ][ VARCHARSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ VARCHARARRAYLEAFSIZE ];
+
+  int keyArrLength;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of COMPOSITE type.
+*/
+struct LeafNodeComposite{
+  /**
+   * Stores keys.
+   */
+	char keyArray[ COMPOSITEARRAYLEAFSIZE ][ COMPOSITESIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ COMPOSITEARRAYLEAFSIZE ];
+
+  int keyArrLength;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of BIGINT type.
+*/
+struct LeafNodeBigint{
+  /**
+   * Stores keys.
+   */
+	std::int64_t keyArray[ BIGINTARRAYLEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ BIGINTARRAYLEAFSIZE ];
+
+  int keyArrLength;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of UNSIGNED type.
+*/
+struct LeafNodeUnsigned{
+  /**
+   * Stores keys.
+   */
+	std::uint32_t keyArray[ UNSIGNEDARRAYLEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ UNSIGNEDARRAYLEAFSIZE ];
+
+  int keyArrLength;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Structure for all leaf nodes when the key is of UBIGINT type.
+*/
+struct LeafNodeUbigint{
+  /**
+   * Stores keys.
+   */
+	std::uint64_t keyArray[ UBIGINTARRAYLEAFSIZE ];
+
+  /**
+   * Stores RecordIds.
+   */
+	RecordId ridArray[ UBIGINTARRAYLEAFSIZE ];
+
+  int keyArrLength;
+
+  /**
+   * Page number of the leaf on the right side.
+	 * This linking of leaves allows to easily move from one leaf to the next leaf during index scan.
+   */
+	PageId rightSibPageNo;
+
+  /**
+   * Page number of the leaf on the left side, 0 for the first leaf. Reverse scans move along it.
+   */
+	PageId leftSibPageNo;
+};
+
+/**
+ * @brief Number of bytes of a posting list kept in the leaf entry of its key.
+ */
+const  int POSTINGINLINESIZE = 24;
+
+/**
+ * @brief Head of the posting list of a key, stored as the payload of the only leaf entry of the key in an index
+ * with posting lists. The record ids of the list are sorted, each one is stored as the varint encoded difference
+ * to the one before of ( page_number << 16 | slot_number ), the first one as the value itself. A short list is
+ * kept in the head itself, a longer one in a chain of overflow pages.
+*/
+struct PostingHead{
+  /**
+   * Number of record ids in the list.
+   */
+	std::uint32_t count;
+
+  /**
+   * First overflow page of the list, 0 if the list is kept in data.
+   */
+	PageId firstPage;
+
+  /**
+   * Encoded record ids of a list without overflow pages.
+   */
+	unsigned char data[ POSTINGINLINESIZE ];
+};
+
+/**
+ * @brief Overflow page of a posting list. Every page holds a run of the list encoded on its own, the runs of the
+ * pages of a chain follow each other in record id order.
+*/
+struct PostingPage{
+  /**
+   * Next page of the chain, 0 for the last one.
+   */
+	PageId nextPage;
+
+  /**
+   * Number of record ids on the page.
+   */
+	std::uint32_t count;
+
+  /**
+   * Encoded record ids.
+   */
+	unsigned char data[ Page::SIZE - sizeof( PageId ) - sizeof( std::uint32_t ) ];
+};
+
+/**
+ * @brief Leaf of an index with packed leaves. The keys are stored as frame of reference: the smallest key of the
+ * leaf is the base, every key is stored as its difference to the base in as many bits as the largest difference
+ * needs, packed one after the other starting at the low bit of the first byte. The record ids follow in the next
+ * byte, each one as the varint encoded difference of ( page_number << 16 | slot_number ) to the one of the entry
+ * before, the first one to 0. Entries are in key order, so the differences are zigzag encoded, see varint.h.
+ * The leaves hang off an ordinary B+ tree, see PackedCore.
+*/
+struct PackedLeaf{
+  /**
+   * Number of entries.
+   */
+	std::uint32_t count;
+
+  /**
+   * Smallest key of the leaf.
+   */
+	int base;
+
+  /**
+   * Number of bits of every key difference, 0 if all keys equal the base.
+   */
+	std::uint32_t bits;
+
+  /**
+   * Packed key differences, then encoded record ids.
+   */
+	unsigned char data[ Page::SIZE - 2 * sizeof( std::uint32_t ) - sizeof( int ) ];
+};
+
+/**
+ * @brief Size in bytes of the largest key type. Scan cursors keep their high value in a buffer of this size.
+ */
+const  int MAXKEYSIZE = VARCHARSIZE;
+
+class BTreeIndex;
+class BTreeCoreBase;
+
+/**
+ * @brief A range scan over a BTreeIndex. Every cursor keeps its own bounds and keeps its own current leaf pinned,
+ * so any number of cursors can scan the same index at once, also while other threads change it. A cursor is used
+ * by one thread at a time. Cursors have to be destroyed before their index.
+ * Record ids can be fetched with scanNext(), scanNextBatch() or by iterating over the cursor:
+ *
+ *   IndexCursor cursor(&index);
+ *   cursor.startScan(&low, GTE, &high, LT);
+ *   for(IndexCursor::iterator it = cursor.begin(); it != cursor.end(); ++ it) { ... *it ... }
+ *   cursor.endScan();
+*/
+class IndexCursor {
+
+ public:
+
+  /**
+   * Input iterator over the record ids of the remaining entries of a scan. Advancing it consumes
+   * entries of the cursor, so all iterators of a cursor share one position.
+   */
+	class iterator {
+	 public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef RecordId value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const RecordId* pointer;
+		typedef const RecordId& reference;
+
+		iterator() : cursor(NULL) {}
+		explicit iterator(IndexCursor* cursor) : cursor(cursor) { ++ (*this); }
+
+		reference operator*() const { return rid; }
+		pointer operator->() const { return &rid; }
+
+		iterator& operator++()
+		{
+			if(!cursor->tryScanNext(rid)) cursor = NULL;
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const { return cursor == other.cursor; }
+		bool operator!=(const iterator& other) const { return cursor != other.cursor; }
+
+	 private:
+		IndexCursor* cursor;
+		RecordId rid;
+	};
+
+  /**
+   * Index being scanned.
+   */
+	BTreeIndex	*index;
+
+  /**
+   * True if a scan has been started.
+   */
+	bool		scanExecuting;
+
+  /**
+   * Index of next entry to be scanned in current leaf being scanned.
+   */
+	int			nextEntry;
+
+  /**
+   * Page number of current page being scanned.
+   */
+	PageId	currentPageNum;
+
+  /**
+   * Current Page being scanned.
+   */
+	Page		*currentPageData;
+
   /**
    * Low Operator. Can only be GT(>) or GTE(>=).
    */
@@ -413,23 +1025,295 @@ class BTreeIndex {
    */
 	Operator	highOp;
 
+  /**
+   * High value of the scan, stored as the key type of the index.
+   */
+	alignas(8) char	highVal[ MAXKEYSIZE ];
+
+  /**
+   * Low value of the scan, stored as the key type of the index. Only used by reverse scans.
+   */
+	alignas(8) char	lowVal[ MAXKEYSIZE ];
+
+  /**
+   * True if the scan returns entries from the high value down to the low value.
+   */
+	bool		reverse;
+
+  /**
+   * Number of leaves the scan moves on before it reads ahead again.
+   */
+	int			readAheadIn;
+
+  /**
+   * Number of leaves the next read-ahead covers, grows while the scan goes on.
+   */
+	int			readAheadWindow;
+
+  /**
+   * Versions of the latch of the current leaf and of the tree latch taken when the cursor got to the leaf. The
+   * cursor holds no latch, if either version has moved on when it reads the leaf it finds its place again.
+   */
+	std::uint64_t	leafVersion;
+	std::uint64_t	treeVersion;
+
+  /**
+   * Key of the last entry returned, stored as the key type of the index.
+   */
+	alignas(8) char	lastKey[ MAXKEYSIZE ];
+
+  /**
+   * Number of entries with lastKey returned in a row, 0 before the first entry is returned.
+   */
+	int			lastKeyCount;
+
+  /**
+   * Number of entries with lastKey still to be skipped after the cursor found its place again.
+   */
+	int			skipCount;
+
+  /**
+   * Record ids of the posting list of lastKey in scan order, for an index with posting lists. See packedKeys
+   * for an index with packed leaves.
+   */
+	std::vector<RecordId>	postingRids;
+
+  /**
+   * Keys of the entries of postingRids, for an index with packed leaves, where postingRids holds the entries of
+   * the current packed leaf the scan still has to return, in scan order.
+   */
+	std::vector<int>	packedKeys;
+
+  /**
+   * Position in postingRids of the next record id to return.
+   */
+	std::size_t	postingPos;
+
+  /**
+   * Leaf holding the directory entry of the key of postingRids, and the versions of its latch and of the tree
+   * latch when the list was read. If either has moved on, the list is read again.
+   */
+	PageId		postingLeaf;
+	std::uint64_t	postingVersion;
+	std::uint64_t	postingTreeVersion;
+
+  /**
+   * IndexCursor Constructor. No scan is started.
+   * @param index	Index to scan
+   */
+	IndexCursor(BTreeIndex *index);
+
+  /**
+   * IndexCursor Destructor. Ends the scan if it is still running.
+   */
+	~IndexCursor();
+
+	IndexCursor(const IndexCursor&) = delete;
+	IndexCursor& operator=(const IndexCursor&) = delete;
+
+  /**
+	 * Begin a filtered scan of the index, see BTreeIndex::startScan(). A scan this cursor is running is ended first.
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
+	**/
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                     const bool reverse = false);
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan, see BTreeIndex::scanNext().
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	 * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+	**/
+	const void scanNext(RecordId& outRid);
+
+  /**
+	 * Begin a filtered scan of the index without throwing on an empty range, see BTreeIndex::tryStartScan().
+   * @return	False if there is no key in the B+ tree that satisfies the scan criteria
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	**/
+	const bool tryStartScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                        const bool reverse = false);
+
+  /**
+	 * Fetch the record id, and the payload if outPayload is given, of the next index entry without throwing,
+	 * see BTreeIndex::tryScanNext().
+   * @return	False if no scan is running or there are no more entries
+	**/
+	const bool tryScanNext(RecordId& outRid, void* outPayload = NULL);
+
+  /**
+	 * Fetch the record ids, and the payloads if outPayloads is given, of the next index entries that match the scan,
+	 * see BTreeIndex::scanNextBatch().
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const std::size_t scanNextBatch(RecordId* outRids, const std::size_t maxRids, void* outPayloads = NULL);
+
+  /**
+	 * Terminate the scan and unpin its leaf.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const void endScan();
+
+  /**
+   * Iterator at the next entry of the scan, or end() if there is none (or no scan is running).
+   */
+	iterator begin() { return iterator(this); }
+
+  /**
+   * Iterator past the last entry of the scan.
+   */
+	iterator end() { return iterator(); }
+};
+
+/**
+ * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
+ * relation. Any number of scans can run at once through IndexCursor objects, startScan(), scanNext() and endScan()
+ * of the index itself run one scan at a time on a cursor owned by the index.
+ *
+ * insertEntry(), deleteEntry(), deleteRange(), lookup(), lookupBatch() and scans through IndexCursor objects can be
+ * called from several threads at once, each thread using cursors of its own. Readers latch nothing, they check the
+ * version latches of the nodes they read and start over if a writer changed one of them. Writers latch only the
+ * nodes they change. Deletes that merge nodes, range deletes and inserts that change the root run alone. The
+ * constructor, the destructor and the built-in scan are not thread-safe.
+*/
+class BTreeIndex {
+
+ public:
+
+  /**
+   * File object for the index file.
+   */
+	File		*file;
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr	*bufMgr;
+
+  /**
+   * Page number of meta page.
+   */
+	PageId	headerPageNum;
+
+  /**
+   * page number of root page of B+ tree inside index file.
+   */
+	PageId	rootPageNum;
+
+  /**
+   * Page number of the first page freed by deletes, 0 if there is none.
+   */
+	PageId	freePageNum;
+
+  /**
+   * Datatype of attribute over which index is built.
+   */
+	Datatype	attributeType;
+
+  /**
+   * Offset of attribute, over which index is built, inside records. 
+   */
+	int 		attrByteOffset;
+
+  /**
+   * Columns of a COMPOSITE key, empty for the other types.
+   */
+	std::vector<KeyColumn>	keyColumns;
+
+  /**
+   * Payload columns stored next to the record ids, empty if there are none.
+   */
+	std::vector<PayloadColumn>	payloadColumns;
+
+  /**
+   * Size in bytes of the payload of an entry, the sum of the sizes of the payload columns. The size of a
+   * PostingHead for an index with posting lists, scans do not return that payload.
+   */
+	int			payloadSize;
+
+  /**
+   * Number of keys in leaf node, depending upon the type of key.
+   */
+	int			leafOccupancy;
+
+  /**
+   * Number of keys in non-leaf node, depending upon the type of key.
+   */
+	int			nodeOccupancy;
+
+
+	// MEMBERS SPECIFIC TO SCANNING
+
+  /**
+   * Cursor of the scan run by startScan(), scanNext() and endScan().
+   */
+	IndexCursor	scan;
+
+  /**
+   * Tree code for the key type of the index, picked when the index is opened.
+   */
+	BTreeCoreBase	*core;
+
+  /**
+   * Version latches of the nodes and of the tree, see LatchTable.
+   */
+	LatchTable	latches;
+
+  /**
+   * Held while the free list and freePageNum are changed, writers splitting different nodes allocate at once.
+   */
+	std::mutex	freeListMutex;
+
+  /**
+   * Open the index file named after the relation and the key attributes, or create and bulk load it.
+   * attributeType, attrByteOffset and keyColumns have to be set.
+   */
+	void open(const std::string & relationName, std::string & outIndexName, const IndexBuildOptions & buildOptions);
+
 	
  public:
 
   /**
    * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
-	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+	 * Check to see if the corresponding index file exists. If so, open the file, check its meta page and restore
+	 * the root page number, the file is left as it is.
+	 * If not, create it and bulk load entries for every tuple in the base relation.
    *
    * @param relationName        Name of file.
    * @param outIndexName        Return the name of index file.
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
-   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @param buildOptions				Options used by the bulk loader when the index is built from the relation
+   * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters,
+   *                                    or if posting lists are asked for with a DOUBLE key or together with
+   *                                    payload columns.
+   */
+	BTreeIndex(const std::string & relationName, std::string & outIndexName,
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const IndexBuildOptions & buildOptions = IndexBuildOptions());
+	
+
+  /**
+   * BTreeIndex Constructor for a COMPOSITE key over several attributes. Keys are the columns encoded one after the
+   * other in a form that compares with memcmp like the columns compare in order, so a range over the leading columns
+   * is a range of the index. Keys passed to the other methods are COMPOSITESIZE bytes built with makeKey().
+   * The index file is named after the relation and the offsets of all columns.
+   *
+   * @param relationName        Name of file.
+   * @param outIndexName        Return the name of index file.
+   * @param bufMgrIn						Buffer Manager Instance
+   * @param columns							INTEGER, BIGINT, UNSIGNED, UBIGINT, DOUBLE and STRING attributes of the key, at
+   *													most MAXKEYCOLUMNS
+   * @param buildOptions				Options used by the bulk loader when the index is built from the relation
+   * @throws  BadIndexInfoException     If the columns do not fit into COMPOSITESIZE bytes, if posting lists are
+   *                                    asked for, or if the index file exists with other parameters.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const std::vector<KeyColumn> & columns,
+						const IndexBuildOptions & buildOptions = IndexBuildOptions());
 	
 
   /**
@@ -442,17 +1326,23 @@ class BTreeIndex {
 
   void insertNode();
 
-  const std::pair<std::pair<PageId, PageId>, void*> insertRecursive(PageId root, const void *key, const RecordId rid, int lastLevel);
-
-  const PageId findPageNoInNonLeaf(Page* node, const void* key);
+  /**
+	 * Build the COMPOSITE key of the index from values of its leading columns. Columns without a value are filled
+	 * with the lowest possible bytes, or with the highest ones if high is set, so a scan from the low key to the high
+	 * key built from the same values covers every key that starts with them.
+   * @param values			Pointers to the values of the first numValues columns, int / double / char string
+   * @param numValues		Number of values, at most the number of columns
+   * @param outKey			Buffer of COMPOSITESIZE bytes the key is written to
+   * @param high				Fill the remaining columns with the highest bytes instead of the lowest
+	**/
+	const void makeKey(const void* const* values, const int numValues, void* outKey, const bool high = false) const;
 
-  const std::pair<PageId, int*> splitLeafNodeInt(struct LeafNodeInt* node, int* key, const RecordId rid);
-  const std::pair<PageId, double*> splitLeafNodeDouble(struct LeafNodeDouble* node, double* key, const RecordId rid);
-  const std::pair<PageId, char*> splitLeafNodeString(struct LeafNodeString* node, char* key, const RecordId rid);
-  
-  const std::pair<PageId, int*> splitNonLeafNodeInt(struct NonLeafNodeInt* node, PageId left, PageId right, int* key);
-  const std::pair<PageId, double*> splitNonLeafNodeDouble(struct NonLeafNodeDouble* node, PageId left, PageId right, double* key);
-  const std::pair<PageId, char*> splitNonLeafNodeString(struct NonLeafNodeString* node, PageId left, PageId right, char* key);
+  /**
+	 * Build the COMPOSITE key of a record of the base relation, as stored in the index.
+   * @param record			Record data
+   * @param outKey			Buffer of COMPOSITESIZE bytes the key is written to
+	**/
+	const void makeRecordKey(const char* record, void* outKey) const;
 
   /**
 	 * Insert a new entry using the pair <value,rid>. 
@@ -462,8 +1352,73 @@ class BTreeIndex {
 	 * Make sure to unpin pages as soon as you can.
    * @param key			Key to insert, pointer to integer/double/char string
    * @param rid			Record ID of a record whose entry is getting inserted into the index.
+   * @param payload	Payload of the entry, payloadSize bytes as built by makePayload(). Zero if not given.
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	**/
+	const void insertEntry(const void* key, const RecordId rid, const void* payload = NULL);
+
+  /**
+	 * Copy the payload columns of a record of the base relation into the payload of its entry.
+   * @param record			Record data
+   * @param outPayload	Buffer of payloadSize bytes the payload is written to
+	**/
+	const void makePayload(const char* record, void* outPayload) const;
+
+
+  /**
+	 * Delete the entry <key, rid>. Of several entries with the key only the one with this rid is removed.
+	 * A leaf or non-leaf node that drops below half full takes entries from a sibling, or is merged with it
+	 * if both together fit into one node; this may continue up to the root, which shrinks the tree when
+	 * it is left with a single non-leaf child. Pages of merged nodes are reused by later inserts.
+	 * Scans through IndexCursor objects may run meanwhile; one whose leaf changes continues after the last key it returned.
+   * @param key			Key of the entry, pointer to integer/double/char string
+   * @param rid			Record ID of the entry
+   * @return	False if the index has no such entry
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	**/
+	const bool deleteEntry(const void* key, const RecordId rid);
+
+
+  /**
+	 * Delete all entries in a key range, with the operators of startScan(). The leaves that hold only entries of the
+	 * range and the subtrees above them are freed as a whole, only the two leaves at the ends of the range are trimmed
+	 * and linked to each other, and the nodes on the way to them are rebalanced as in deleteEntry(). The cost depends
+	 * on the height of the tree and the number of pages freed, not on the number of entries deleted.
+	 * Scans through IndexCursor objects may run meanwhile, as for deleteEntry().
+   * @param lowVal	Low value of range, pointer to integer / double / char string
+   * @param lowOp		Low operator (GT/GTE)
+   * @param highVal	High value of range, pointer to integer / double / char string
+   * @param highOp	High operator (LT/LTE)
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
 	**/
-	const void insertEntry(const void* key, const RecordId rid);
+	const void deleteRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+  /**
+	 * Find the record ids of all entries with the given key. Descends to the leftmost leaf that may hold the key and
+	 * collects the matching entries, following right siblings while duplicates run on. Needs no scan and leaves no
+	 * page pinned, so equality probes do not pay for the scan setup and endScan.
+   * @param key			Key to look for, pointer to integer/double/char string
+   * @param outRids	Cleared and filled with the record ids of the matching entries
+   * @return	Number of matching entries, 0 if the key is not in the index
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	**/
+	const std::size_t lookup(const void* key, std::vector<RecordId>& outRids);
+
+
+  /**
+	 * Find the record ids of the entries for many keys at once. The keys are sorted and the tree is walked once,
+	 * all keys that go to the same node are resolved while it is pinned, so each node on the way is read once per
+	 * batch instead of once per key.
+   * @param keys		Array of n keys of the attribute type, int / std::int64_t / std::uint32_t / std::uint64_t /
+   *							double / char[STRINGSIZE] / char[VARCHARSIZE] / char[COMPOSITESIZE] each
+   * @param n				Number of keys
+   * @param results	Resized to n, results[i] is filled with the record ids of the entries equal to keys[i]
+   * @return	Total number of record ids found
+	**/
+	const std::size_t lookupBatch(const void* keys, const std::size_t n, std::vector<std::vector<RecordId> >& results);
 
 
   /**
@@ -477,11 +1432,15 @@ class BTreeIndex {
    * @param lowOp		Low operator (GT/GTE)
    * @param highVal	High value of range, pointer to integer / double / char string
    * @param highOp	High operator (LT/LTE)
+   * @param reverse	Return the entries in descending key order, starting at the high value and moving to the
+   *								left sibling of each leaf, e.g. for the latest N entries of a range
    * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
    * @throws  BadScanrangeException If lowVal > highval
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
 	 * @throws  NoSuchKeyFoundException If there is no key in the B+ tree that satisfies the scan criteria.
 	**/
-	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+	const void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                     const bool reverse = false);
 
 
   /**
@@ -494,6 +1453,44 @@ class BTreeIndex {
 	const void scanNext(RecordId& outRid);  // returned record id
 
 
+  /**
+	 * Begin a filtered scan of the index like startScan(), but report an empty range by the return value.
+	 * Meant for loops over many short ranges, where the cost of throwing NoSuchKeyFoundException dominates the scan.
+   * @return	False if there is no key in the B+ tree that satisfies the scan criteria, no scan is running then
+   * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values 
+   * @throws  BadScanrangeException If lowVal > highval
+   * @throws  KeyTooLongException If a VARCHAR key is longer than VARCHARSIZE characters
+	**/
+	const bool tryStartScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+	                        const bool reverse = false);
+
+
+  /**
+	 * Fetch the record id of the next index entry that matches the scan like scanNext(), but report the end
+	 * of the scan by the return value.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @param outPayload	If given, buffer of payloadSize bytes the payload of the entry is copied to, so that
+   *										queries on the payload columns need not read the record
+   * @return	False if no scan is running or no more records, satisfying the scan criteria, are left to be scanned
+	**/
+	const bool tryScanNext(RecordId& outRid, void* outPayload = NULL);
+
+
+  /**
+	 * Fetch the record ids of the next index entries that match the scan, up to maxRids of them.
+	 * The qualifying slice of each leaf is found once with a binary search on the high value and copied as a block,
+	 * then the scan moves on to the right sibling until outRids is full or the scan range ends. Reverse scans search
+	 * on the low value, copy the slice backwards and move on to the left sibling.
+   * @param outRids	Buffer of at least maxRids record ids the matching record ids are written to
+   * @param maxRids	Maximum number of record ids to return
+   * @param outPayloads	If given, buffer of maxRids payloads of payloadSize bytes the payloads of the
+   *										entries are written to, in the order of outRids
+   * @return	Number of record ids written to outRids, 0 once all matching entries have been returned
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	const std::size_t scanNextBatch(RecordId* outRids, const std::size_t maxRids, void* outPayloads = NULL);
+
+
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
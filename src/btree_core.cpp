@@ -0,0 +1,2208 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "btree_core.h"
+#include "filescan.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "page_iterator.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <exception>
+
+namespace badgerdb
+{
+
+// -----------------------------------------------------------------------------
+// BTreeCore::BTreeCore -- Constructor
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+BTreeCore<Traits>::BTreeCore(BTreeIndex* index) : index(index) {
+	static_assert(sizeof(KeyType) <= MAXKEYSIZE, "key type does not fit into the key buffer of IndexCursor");
+	static_assert(sizeof(LeafNode) <= Page::SIZE && sizeof(NonLeafNode) <= Page::SIZE, "node does not fit into a page");
+	// payloads take the rid slots after the occupancy, m entries need m * (rid + payload) bytes of the rid array
+	index->leafOccupancy = Traits::LEAFSIZE * sizeof(RecordId) / (sizeof(RecordId) + index->payloadSize);
+	index->nodeOccupancy = Traits::NONLEAFSIZE;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::buildIndex -- collect and sort <key, rid> pairs of the relation
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions) {
+	if(index->payloadSize > 0) {
+		sortAndLoad<RIDKeyPayload<KeyType> >(relationName, buildOptions);
+	} else {
+		sortAndLoad<RIDKeyPair<KeyType> >(relationName, buildOptions);
+	}
+}
+
+template <class Traits>
+template <class Entry>
+void BTreeCore<Traits>::sortAndLoad(const std::string & relationName, const IndexBuildOptions & buildOptions) {
+	ExternalSorter<Entry> sorter(index->bufMgr, index->file->filename() + ".sort", buildOptions.sortMemPages);
+	sortRelation(relationName, buildOptions, sorter);
+	bulkLoad(sorter, buildOptions.fillFactor);
+}
+
+template <class Traits>
+template <class Entry>
+void BTreeCore<Traits>::sortRelation(const std::string & relationName, const IndexBuildOptions & buildOptions,
+                                     ExternalSorter<Entry> & sorter) {
+	// scan relation and pick key and payload of every record
+	if(buildOptions.buildThreads > 1) {
+		scanRelationParallel(relationName, sorter, buildOptions.buildThreads);
+	} else {
+		FileScan fileScan(relationName, index->bufMgr);
+		Entry entry;
+		while(fileScan.tryScanNext(entry.rid)) {
+			loadRecordEntry(fileScan.getRecord().c_str(), entry);
+			sorter.add(entry);
+		}
+	}
+
+	sorter.finish();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::loadRecordKey
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::loadRecordKey(const char* record, KeyType & key) const {
+	if(index->attributeType == COMPOSITE) {
+		char buf[COMPOSITESIZE];
+		index->makeRecordKey(record, buf);
+		Traits::load(buf, key);
+	} else {
+		Traits::load(record + index->attrByteOffset, key);
+	}
+}
+
+template <class Traits>
+void BTreeCore<Traits>::loadRecordEntry(const char* record, RIDKeyPayload<KeyType> & entry) const {
+	loadRecordKey(record, entry.key);
+	index->makePayload(record, entry.payload);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::movePayloads / setPayload
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::movePayloads(LeafNode* dst, const int dstPos, LeafNode* src, const int srcPos,
+                                     const int n) const {
+	const int size = index->payloadSize;
+	if(size == 0 || n <= 0) return;
+	memmove(payloadsOf(dst) + dstPos * size, payloadsOf(src) + srcPos * size, n * size);
+}
+
+template <class Traits>
+void BTreeCore<Traits>::setPayload(LeafNode* leaf, const int pos, const void* payload) const {
+	const int size = index->payloadSize;
+	if(size == 0) return;
+	if(payload != NULL) {
+		memcpy(payloadsOf(leaf) + pos * size, payload, size);
+	} else {
+		memset(payloadsOf(leaf) + pos * size, 0, size);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::scanRelationParallel -- scan page ranges of the relation in threads
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+template <class Entry>
+void BTreeCore<Traits>::scanRelationParallel(const std::string & relationName, ExternalSorter<Entry> & sorter,
+                                             const int numThreads) {
+	PageFile relation(relationName, false);
+
+	// collect page numbers, the iterator only reads page headers
+	std::vector<PageId> pageNos;
+	for(FileIterator iter = relation.begin(); iter != relation.end(); iter ++) {
+		pageNos.push_back(iter.page_number());
+	}
+
+	// buffer manager, file and sorter are shared, so they are only used under the lock
+	std::mutex mutex;
+	std::vector<std::exception_ptr> errors(numThreads);
+	// the runs being built share the half of the sort memory that the sorter leaves free while runs are added
+	const std::size_t runCap = std::max<std::size_t>(1, sorter.capacity() / 2 / numThreads);
+	BufMgr* bufMgr = index->bufMgr;
+
+	std::vector<std::thread> workers;
+	for(int t = 0; t < numThreads; t ++) {
+		const std::size_t begin = pageNos.size() * t / numThreads;
+		const std::size_t end = pageNos.size() * (t + 1) / numThreads;
+		workers.push_back(std::thread([&, t, begin, end]() {
+			try {
+				std::vector<Entry> run;
+				for(std::size_t i = begin; i < end; i ++) {
+					// copy page so it is unpinned before the records are parsed
+					Page page;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						Page* bufPage;
+						bufMgr->readPage(&relation, pageNos[i], bufPage);
+						page = *bufPage;
+						bufMgr->unPinPage(&relation, pageNos[i], false);
+					}
+
+					for(PageIterator iter = page.begin(); iter != page.end(); iter ++) {
+						Entry entry;
+						entry.rid = iter.getCurrentRecord();
+						loadRecordEntry((*iter).c_str(), entry);
+						run.push_back(entry);
+
+						// local runs are bounded by this thread's share of half the sort memory
+						if(run.size() == runCap) {
+							std::sort(run.begin(), run.end());
+							std::lock_guard<std::mutex> lock(mutex);
+							sorter.addSortedRun(run);
+							run.clear();
+						}
+					}
+				}
+				std::sort(run.begin(), run.end());
+				std::lock_guard<std::mutex> lock(mutex);
+				sorter.addSortedRun(run);
+			} catch(...) {
+				errors[t] = std::current_exception();
+			}
+		}));
+	}
+
+	for(int t = 0; t < numThreads; t ++) {
+		workers[t].join();
+	}
+	bufMgr->flushFile(&relation);
+	for(int t = 0; t < numThreads; t ++) {
+		if(errors[t]) std::rethrow_exception(errors[t]);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::bulkLoad -- build the tree bottom-up from sorted entries
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+template <class Entry>
+void BTreeCore<Traits>::bulkLoad(ExternalSorter<Entry> & entries, const double fillFactor) {
+	const int total = entries.size();
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// empty relation, root is an empty non leaf right above the (not yet allocated) leaves
+	if(total == 0) {
+		Page* rootPage;
+		bufMgr->allocPage(file, index->rootPageNum, rootPage);
+		NonLeafNode* root = (NonLeafNode*)rootPage;
+		memset(root, 0, sizeof(NonLeafNode));
+		root->level = 1;
+		bufMgr->unPinPage(file, index->rootPageNum, true);
+		return;
+	}
+
+	const double fill = std::min(1.0, std::max(0.0, fillFactor));
+	const int leafCap = std::max(1, (int)(index->leafOccupancy * fill));
+	const int nodeCap = std::max(2, (int)(index->nodeOccupancy * fill));
+
+	const int numLeaves = (total + leafCap - 1) / leafCap;
+
+	// separator to the left of and page no of every node of the level built last
+	std::vector<PageKeyPair<KeyType> > level;
+	level.reserve(numLeaves);
+
+	// write leaves left to right, entries are spread evenly and the last leaves take the remainder
+	LeafNode* prevLeaf = NULL;
+	PageId prevLeafId = 0;
+	for(int i = 0; i < numLeaves; i ++) {
+		const int cnt = total / numLeaves + (i >= numLeaves - total % numLeaves ? 1 : 0);
+		Page* leafPage;
+		PageId leafId;
+		bufMgr->allocPage(file, leafId, leafPage);
+		LeafNode* leaf = (LeafNode*)leafPage;
+		memset(leaf, 0, sizeof(LeafNode));
+		leaf->leftSibPageNo = prevLeafId;
+
+		PageKeyPair<KeyType> child = PageKeyPair<KeyType>();
+		child.pageNo = leafId;
+		for(int j = 0; j < cnt; j ++) {
+			Entry entry;
+			entries.next(entry);
+			if(j == 0 && prevLeaf != NULL) {
+				const int prevCnt = prevLeaf->keyArrLength;
+				child.key = (prevCnt > 0) ? Traits::separator(keysOf(prevLeaf)[prevCnt - 1], entry.key) : entry.key;
+			}
+			keysOf(leaf)[j] = entry.key;
+			leaf->ridArray[j] = entry.rid;
+			setPayload(leaf, j, payloadOf(entry));
+		}
+		leaf->keyArrLength = cnt;
+		level.push_back(child);
+
+		// link previous leaf to this one, this one points back to it already
+		if(prevLeaf != NULL) {
+			prevLeaf->rightSibPageNo = leafId;
+			bufMgr->unPinPage(file, prevLeafId, true);
+		}
+		prevLeaf = leaf;
+		prevLeafId = leafId;
+	}
+	bufMgr->unPinPage(file, prevLeafId, true);
+
+	// build non leaf levels until only the root is left, the root is a non leaf even above a single leaf and
+	// has no keys then
+	int nodeLevel = 1;
+	do {
+		const int children = level.size();
+		const int numNodes = (children + nodeCap) / (nodeCap + 1);
+		std::vector<PageKeyPair<KeyType> > upper;
+		upper.reserve(numNodes);
+
+		int next = 0;
+		for(int i = 0; i < numNodes; i ++) {
+			const int cnt = children / numNodes + (i >= numNodes - children % numNodes ? 1 : 0);
+			Page* nodePage;
+			PageId nodeId;
+			bufMgr->allocPage(file, nodeId, nodePage);
+			NonLeafNode* node = (NonLeafNode*)nodePage;
+			memset(node, 0, sizeof(NonLeafNode));
+			node->level = nodeLevel;
+
+			// separator between two children is the separator left of the right child
+			node->pageNoArray[0] = level[next].pageNo;
+			for(int j = 1; j < cnt; j ++) {
+				keysOf(node)[j - 1] = level[next + j].key;
+				node->pageNoArray[j] = level[next + j].pageNo;
+			}
+			node->keyArrLength = cnt - 1;
+
+			PageKeyPair<KeyType> child;
+			child.set(nodeId, level[next].key);
+			upper.push_back(child);
+			next += cnt;
+			bufMgr->unPinPage(file, nodeId, true);
+		}
+
+		level.swap(upper);
+		nodeLevel = 0;
+	} while(level.size() > 1);
+
+	index->rootPageNum = level[0].pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::findChild -- find page number in non leaf
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+PageId BTreeCore<Traits>::findChild(NonLeafNode* node, const KeyType & key) {
+	// child right of the last separator that is less than or equal to key
+	return node->pageNoArray[Traits::upperBound(keysOf(node), node->keyArrLength, key)];
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertToLeaf -- insert key to leaf
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::insertToLeaf(LeafNode* leaf, const KeyType & key, const RecordId rid, const void* payload) {
+	// find place to insert, shift keys, rids and payloads right
+	KeyType* keys = keysOf(leaf);
+	const int i = Traits::upperBound(keys, leaf->keyArrLength, key);
+	memmove(&keys[i + 1], &keys[i], (leaf->keyArrLength - i) * sizeof(KeyType));
+	memmove(&leaf->ridArray[i + 1], &leaf->ridArray[i], (leaf->keyArrLength - i) * sizeof(RecordId));
+	movePayloads(leaf, i + 1, leaf, i, leaf->keyArrLength - i);
+	keys[i] = key;
+	leaf->ridArray[i] = rid;
+	setPayload(leaf, i, payload);
+	leaf->keyArrLength ++;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertToNonLeaf -- insert key to non leaf
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::insertToNonLeaf(NonLeafNode* node, const KeyType & key, const PageId rightPage) {
+	// find place to insert, shift keys and page numbers right of the key right
+	KeyType* keys = keysOf(node);
+	const int i = Traits::upperBound(keys, node->keyArrLength, key);
+	memmove(&keys[i + 1], &keys[i], (node->keyArrLength - i) * sizeof(KeyType));
+	memmove(&node->pageNoArray[i + 2], &node->pageNoArray[i + 1], (node->keyArrLength - i) * sizeof(PageId));
+	keys[i] = key;
+	node->pageNoArray[i + 1] = rightPage;
+	node->keyArrLength ++;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::splitLeaf -- split leaf node
+// -----------------------------------------------------------------------------
+
+/*
+Splits work on the key and rid / page no arrays of the full node in place: the entries that move to the new
+node are copied over in at most three blocks and the new entry is put into whichever node it belongs to. No
+temporary copy of the node is built, and equal keys keep their order and their rids.
+*/
+
+template <class Traits>
+PageKeyPair<typename Traits::KeyType> BTreeCore<Traits>::splitLeaf(LeafNode* node, const PageId nodeId,
+                                                                   const KeyType & key, const RecordId rid,
+                                                                   const void* payload) {
+	// allocate a new leaf
+	Page* newNodePage;
+	PageId newNodePageId;
+	allocNode(newNodePageId, newNodePage);
+	LeafNode* newNode = (LeafNode*)newNodePage;
+
+	// position of the new entry among the n + 1 entries, the first leftCnt of them stay in the left node
+	const int n = node->keyArrLength;
+	const int leftCnt = (n + 1) / 2;
+	const int rightCnt = n + 1 - leftCnt;
+	KeyType* keys = keysOf(node);
+	KeyType* newKeys = keysOf(newNode);
+	RecordId* rids = node->ridArray;
+	RecordId* newRids = newNode->ridArray;
+	const int pos = Traits::upperBound(keys, n, key);
+
+	if(pos < leftCnt) {
+		// new entry stays left, the last rightCnt old entries move right
+		memcpy(newKeys, &keys[n - rightCnt], rightCnt * sizeof(KeyType));
+		memcpy(newRids, &rids[n - rightCnt], rightCnt * sizeof(RecordId));
+		movePayloads(newNode, 0, node, n - rightCnt, rightCnt);
+		memmove(&keys[pos + 1], &keys[pos], (leftCnt - 1 - pos) * sizeof(KeyType));
+		memmove(&rids[pos + 1], &rids[pos], (leftCnt - 1 - pos) * sizeof(RecordId));
+		movePayloads(node, pos + 1, node, pos, leftCnt - 1 - pos);
+		keys[pos] = key;
+		rids[pos] = rid;
+		setPayload(node, pos, payload);
+	} else {
+		// new entry goes right, between the old entries before and after pos
+		const int before = pos - leftCnt;
+		memcpy(newKeys, &keys[leftCnt], before * sizeof(KeyType));
+		memcpy(newRids, &rids[leftCnt], before * sizeof(RecordId));
+		movePayloads(newNode, 0, node, leftCnt, before);
+		newKeys[before] = key;
+		newRids[before] = rid;
+		setPayload(newNode, before, payload);
+		memcpy(&newKeys[before + 1], &keys[pos], (n - pos) * sizeof(KeyType));
+		memcpy(&newRids[before + 1], &rids[pos], (n - pos) * sizeof(RecordId));
+		movePayloads(newNode, before + 1, node, pos, n - pos);
+	}
+	node->keyArrLength = leftCnt;
+	newNode->keyArrLength = rightCnt;
+
+	// set sibling ptrs, the old right sibling now follows the new leaf
+	newNode->rightSibPageNo = node->rightSibPageNo;
+	newNode->leftSibPageNo = nodeId;
+	node->rightSibPageNo = newNodePageId;
+	setLeftSibling(newNode->rightSibPageNo, newNodePageId);
+
+	PageKeyPair<KeyType> split;
+	split.set(newNodePageId, Traits::separator(keys[leftCnt - 1], newKeys[0]));
+	index->bufMgr->unPinPage(index->file, newNodePageId, true);
+	return split;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::splitNonLeaf -- split non leaf node
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+PageKeyPair<typename Traits::KeyType> BTreeCore<Traits>::splitNonLeaf(NonLeafNode* node, const KeyType & key,
+                                                                      const PageId rightPage) {
+	// allocate a new non leaf
+	Page* newNodePage;
+	PageId newNodePageId;
+	allocNode(newNodePageId, newNodePage);
+	NonLeafNode* newNode = (NonLeafNode*)newNodePage;
+
+	// of the n + 1 keys the first leftCnt stay, the next one moves up and the rest move right
+	// together with the page numbers right of them
+	const int n = node->keyArrLength;
+	const int leftCnt = n / 2;
+	const int rightCnt = n - leftCnt;
+	KeyType* keys = keysOf(node);
+	KeyType* newKeys = keysOf(newNode);
+	PageId* pages = node->pageNoArray;
+	PageId* newPages = newNode->pageNoArray;
+	const int pos = Traits::upperBound(keys, n, key);
+
+	PageKeyPair<KeyType> split;
+	if(pos < leftCnt) {
+		// new key stays left, the last old key of the left half moves up
+		split.set(newNodePageId, keys[leftCnt - 1]);
+		memcpy(newKeys, &keys[leftCnt], rightCnt * sizeof(KeyType));
+		memcpy(newPages, &pages[leftCnt], (rightCnt + 1) * sizeof(PageId));
+		memmove(&keys[pos + 1], &keys[pos], (leftCnt - 1 - pos) * sizeof(KeyType));
+		memmove(&pages[pos + 2], &pages[pos + 1], (leftCnt - 1 - pos) * sizeof(PageId));
+		keys[pos] = key;
+		pages[pos + 1] = rightPage;
+	} else if(pos == leftCnt) {
+		// new key moves up, its right page is the first child of the new node
+		split.set(newNodePageId, key);
+		memcpy(newKeys, &keys[leftCnt], rightCnt * sizeof(KeyType));
+		newPages[0] = rightPage;
+		memcpy(&newPages[1], &pages[leftCnt + 1], rightCnt * sizeof(PageId));
+	} else {
+		// new key goes right, the first old key of the right half moves up
+		const int before = pos - leftCnt - 1;
+		split.set(newNodePageId, keys[leftCnt]);
+		memcpy(newKeys, &keys[leftCnt + 1], before * sizeof(KeyType));
+		memcpy(newPages, &pages[leftCnt + 1], (before + 1) * sizeof(PageId));
+		newKeys[before] = key;
+		newPages[before + 1] = rightPage;
+		memcpy(&newKeys[before + 1], &keys[pos], (n - pos) * sizeof(KeyType));
+		memcpy(&newPages[before + 2], &pages[pos + 1], (n - pos) * sizeof(PageId));
+	}
+	node->keyArrLength = leftCnt;
+	newNode->keyArrLength = rightCnt;
+	newNode->level = node->level;
+
+	index->bufMgr->unPinPage(index->file, newNodePageId, true);
+	return split;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertRecursive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::insertRecursive(const PageId nodeId, const KeyType & key, const RecordId rid,
+                                        const void* payload, const int lastLevel, PageKeyPair<KeyType> & split) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	Page* page;
+	bufMgr->readPage(file, nodeId, page);
+
+	// is a leaf, insert or split
+	if(lastLevel == 1) {
+		LeafNode* leaf = (LeafNode*)page;
+		if(leaf->keyArrLength < index->leafOccupancy) {
+			insertToLeaf(leaf, key, rid, payload);
+			bufMgr->unPinPage(file, nodeId, true);
+			return false;
+		}
+		split = splitLeaf(leaf, nodeId, key, rid, payload);
+		bufMgr->unPinPage(file, nodeId, true);
+		return true;
+	}
+
+	// not a leaf, node is unpinned while the child is updated
+	NonLeafNode* node = (NonLeafNode*)page;
+	const PageId childId = findChild(node, key);
+	const int level = node->level;
+	bufMgr->unPinPage(file, nodeId, false);
+
+	PageKeyPair<KeyType> childSplit;
+	if(!insertRecursive(childId, key, rid, payload, level, childSplit)) {
+		return false;
+	}
+
+	// child was split, propagate up
+	bufMgr->readPage(file, nodeId, page);
+	node = (NonLeafNode*)page;
+	if(node->keyArrLength < index->nodeOccupancy) {
+		insertToNonLeaf(node, childSplit.key, childSplit.pageNo);
+		bufMgr->unPinPage(file, nodeId, true);
+		return false;
+	}
+	split = splitNonLeaf(node, childSplit.key, childSplit.pageNo);
+	bufMgr->unPinPage(file, nodeId, true);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertEntry
+// -----------------------------------------------------------------------------
+
+/*
+Inserts use optimistic lock coupling. The leaf is found without latching, remembering the versions of the nodes
+passed. A leaf with a free slot is latched only if it is unchanged since it was read, and the entry goes in.
+A full leaf is split together with the full nodes above it, latching them and the lowest node with a free slot.
+Whenever a latch cannot be taken at the version read, the insert starts over from the root. Inserts into an
+empty tree and inserts that split the root change the root page number and run alone under the tree latch.
+*/
+
+template <class Traits>
+void BTreeCore<Traits>::insertEntry(const void* keyParm, const RecordId rid, const void* payload) {
+	KeyType key;
+	Traits::load(keyParm, key);
+
+	bool present;
+	if(insertOptimistic(key, rid, payload, false, present)) return;
+	TreeLock lock(index->latches);
+	insertExclusive(key, rid, payload);
+}
+
+template <class Traits>
+bool BTreeCore<Traits>::insertOptimistic(const KeyType & key, const RecordId rid, const void* payload,
+                                         const bool unique, bool & present) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	present = false;
+	std::vector<PathStep> path;
+	while(true) {
+		path.clear();
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t leafVersion;
+		if(!findLeafOptimistic(key, false, treeVersion, leafId, leafVersion, &path)) continue;
+		if(leafId == 0) return false;
+
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int len = lengthOf(leaf);
+
+		// a key that is in the tree is in the leaf an insert of it goes to
+		if(unique) {
+			const int pos = Traits::lowerBound(keysOf(leaf), len, key);
+			if(pos < len && !(key < keysOf(leaf)[pos])) {
+				bufMgr->unPinPage(file, leafId, false);
+				if(!validate(leafId, leafVersion, treeVersion)) continue;
+				present = true;
+				return true;
+			}
+		}
+		if(len < index->leafOccupancy) {
+			if(!latches.node(leafId).tryUpgrade(leafVersion)) {
+				bufMgr->unPinPage(file, leafId, false);
+				continue;
+			}
+			if(!latches.tree().validate(treeVersion)) {
+				latches.node(leafId).unlock();
+				bufMgr->unPinPage(file, leafId, false);
+				continue;
+			}
+			insertToLeaf(leaf, key, rid, payload);
+			bufMgr->unPinPage(file, leafId, true);
+			latches.node(leafId).unlock();
+			return true;
+		}
+		bufMgr->unPinPage(file, leafId, false);
+
+		// the separator of the new leaf goes up to the lowest node with a free slot, none means the root splits
+		int top = (int)path.size() - 1;
+		while(top >= 0 && path[top].keyCount >= index->nodeOccupancy) top --;
+		if(top < 0) return false;
+		if(insertSplitting(path, top, leafId, leafVersion, treeVersion, key, rid, payload)) return true;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertSplitting
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::insertSplitting(const std::vector<PathStep> & path, const int top, const PageId leafId,
+                                        const std::uint64_t leafVersion, const std::uint64_t treeVersion,
+                                        const KeyType & key, const RecordId rid, const void* payload) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	// nodes sharing a latch stripe share the latch, it is taken once and must be at the same version for both
+	std::vector<std::pair<VersionLatch*, std::uint64_t> > held;
+	auto upgrade = [&held](VersionLatch & latch, const std::uint64_t version) {
+		for(std::size_t i = 0; i < held.size(); i ++) {
+			if(held[i].first == &latch) return held[i].second == version;
+		}
+		if(!latch.tryUpgrade(version)) return false;
+		held.push_back(std::make_pair(&latch, version));
+		return true;
+	};
+	auto release = [&held]() {
+		for(std::size_t i = 0; i < held.size(); i ++) held[i].first->unlock();
+	};
+
+	bool latched = true;
+	for(std::size_t k = top; latched && k < path.size(); k ++) {
+		latched = upgrade(latches.node(path[k].pageNo), path[k].version);
+	}
+	latched = latched && upgrade(latches.node(leafId), leafVersion);
+	if(!latched) {
+		release();
+		return false;
+	}
+
+	// the right sibling of the leaf gets the new leaf as its left sibling
+	Page* page;
+	bufMgr->readPage(file, leafId, page);
+	LeafNode* leaf = (LeafNode*)page;
+	const PageId rightId = leaf->rightSibPageNo;
+	if(rightId != 0) {
+		VersionLatch & rightLatch = latches.node(rightId);
+		bool shared = false;
+		for(std::size_t i = 0; i < held.size(); i ++) shared = shared || held[i].first == &rightLatch;
+		if(!shared && rightLatch.tryLock()) {
+			held.push_back(std::make_pair(&rightLatch, (std::uint64_t)0));
+		} else if(!shared) {
+			latched = false;
+		}
+	}
+	if(!latched || !latches.tree().validate(treeVersion)) {
+		bufMgr->unPinPage(file, leafId, false);
+		release();
+		return false;
+	}
+
+	try {
+		PageKeyPair<KeyType> split = splitLeaf(leaf, leafId, key, rid, payload);
+		bufMgr->unPinPage(file, leafId, true);
+		for(int k = (int)path.size() - 1; k >= top; k --) {
+			bufMgr->readPage(file, path[k].pageNo, page);
+			NonLeafNode* node = (NonLeafNode*)page;
+			if(k == top) {
+				insertToNonLeaf(node, split.key, split.pageNo);
+			} else {
+				split = splitNonLeaf(node, split.key, split.pageNo);
+			}
+			bufMgr->unPinPage(file, path[k].pageNo, true);
+		}
+	} catch(...) {
+		release();
+		throw;
+	}
+	release();
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::insertExclusive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::insertExclusive(const KeyType & key, const RecordId rid, const void* payload) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// empty tree, the first key becomes the root key with an empty leaf on each side. A root without keys
+	// that still has a child is not empty, deletes leave it behind above the last leaf
+	Page* rootPage;
+	bufMgr->readPage(file, index->rootPageNum, rootPage);
+	NonLeafNode* rootNode = (NonLeafNode*)rootPage;
+	const bool emptyTree = (rootNode->pageNoArray[0] == 0);
+	if(emptyTree) {
+		Page* leftPage;
+		PageId leftPageId;
+		Page* rightPage;
+		PageId rightPageId;
+		allocNode(rightPageId, rightPage);
+		allocNode(leftPageId, leftPage);
+		memset((LeafNode*)rightPage, 0, sizeof(LeafNode));
+		memset((LeafNode*)leftPage, 0, sizeof(LeafNode));
+		((LeafNode*)leftPage)->rightSibPageNo = rightPageId;
+		((LeafNode*)rightPage)->leftSibPageNo = leftPageId;
+
+		keysOf(rootNode)[0] = key;
+		rootNode->pageNoArray[0] = leftPageId;
+		rootNode->pageNoArray[1] = rightPageId;
+		rootNode->keyArrLength = 1;
+		bufMgr->unPinPage(file, rightPageId, true);
+		bufMgr->unPinPage(file, leftPageId, true);
+	}
+	bufMgr->unPinPage(file, index->rootPageNum, emptyTree);
+
+	// recursively insert
+	PageKeyPair<KeyType> split;
+	if(!insertRecursive(index->rootPageNum, key, rid, payload, 0, split)) {
+		return;
+	}
+
+	// root is split, new root on top of the old root and its new sibling
+	Page* newRootPage;
+	PageId newRootPageId;
+	allocNode(newRootPageId, newRootPage);
+	NonLeafNode* newRoot = (NonLeafNode*)newRootPage;
+	memset(newRoot, 0, sizeof(NonLeafNode));
+	keysOf(newRoot)[0] = split.key;
+	newRoot->pageNoArray[0] = index->rootPageNum;
+	newRoot->pageNoArray[1] = split.pageNo;
+	newRoot->level = 0;
+	newRoot->keyArrLength = 1;
+	bufMgr->unPinPage(file, newRootPageId, true);
+	index->rootPageNum = newRootPageId;
+
+	// set index meta page
+	Page* headerPage;
+	bufMgr->readPage(file, index->headerPageNum, headerPage);
+	((IndexMetaInfo*)headerPage)->rootPageNo = newRootPageId;
+	bufMgr->unPinPage(file, index->headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::deleteEntry
+// -----------------------------------------------------------------------------
+
+/*
+A delete that leaves its leaf at least half full only latches the leaf, found like an insert finds it. The leaf
+is the leftmost one that may hold the key, an entry further down a run of equal keys is looked for in the right
+siblings, reading the latch of each before the one left of it is validated, like a scan moves on. Deletes that
+make a leaf underflow move entries between nodes or merge them, they run alone under the tree latch.
+*/
+
+template <class Traits>
+bool BTreeCore<Traits>::deleteEntry(const void* keyParm, const RecordId rid) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+	KeyType key;
+	Traits::load(keyParm, key);
+
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t leafVersion;
+		if(!findLeafOptimistic(key, true, treeVersion, leafId, leafVersion)) continue;
+		if(leafId == 0) {
+			if(latches.tree().validate(treeVersion)) return false;
+			continue;
+		}
+
+		// find the entry in the leaf or a right sibling, the leaf holding it stays pinned
+		bool valid = true;
+		Page* page;
+		LeafNode* leaf;
+		int i;
+		int len;
+		while(true) {
+			bufMgr->readPage(file, leafId, page);
+			leaf = (LeafNode*)page;
+			KeyType* keys = keysOf(leaf);
+			len = lengthOf(leaf);
+			i = Traits::lowerBound(keys, len, key);
+			while(i < len && !(key < keys[i]) && leaf->ridArray[i] != rid) i ++;
+			if(i < len && !(key < keys[i])) break;
+
+			// a greater key ends the run of equal keys without the entry, so does the last leaf
+			const PageId rightId = leaf->rightSibPageNo;
+			bufMgr->unPinPage(file, leafId, false);
+			if(i < len || rightId == 0) {
+				if(validate(leafId, leafVersion, treeVersion)) return false;
+				valid = false;
+				break;
+			}
+			const std::uint64_t rightVersion = latches.node(rightId).readLock();
+			if(!validate(leafId, leafVersion, treeVersion)) {
+				valid = false;
+				break;
+			}
+			leafId = rightId;
+			leafVersion = rightVersion;
+		}
+		if(!valid) continue;
+		if(len - 1 < index->leafOccupancy / 2) {
+			bufMgr->unPinPage(file, leafId, false);
+			break;
+		}
+
+		if(!latches.node(leafId).tryUpgrade(leafVersion)) {
+			bufMgr->unPinPage(file, leafId, false);
+			continue;
+		}
+		if(!latches.tree().validate(treeVersion)) {
+			latches.node(leafId).unlock();
+			bufMgr->unPinPage(file, leafId, false);
+			continue;
+		}
+		removeFromLeaf(leaf, i);
+		bufMgr->unPinPage(file, leafId, true);
+		latches.node(leafId).unlock();
+		return true;
+	}
+
+	TreeLock lock(latches);
+	return deleteExclusive(key, rid);
+}
+
+template <class Traits>
+void BTreeCore<Traits>::removeFromLeaf(LeafNode* leaf, const int pos) {
+	KeyType* keys = keysOf(leaf);
+	const int len = leaf->keyArrLength;
+	memmove(&keys[pos], &keys[pos + 1], (len - 1 - pos) * sizeof(KeyType));
+	memmove(&leaf->ridArray[pos], &leaf->ridArray[pos + 1], (len - 1 - pos) * sizeof(RecordId));
+	movePayloads(leaf, pos, leaf, pos + 1, len - 1 - pos);
+	leaf->keyArrLength = len - 1;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::deleteExclusive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::deleteExclusive(const KeyType & key, const RecordId rid) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// empty tree
+	Page* rootPage;
+	bufMgr->readPage(file, index->rootPageNum, rootPage);
+	const bool emptyTree = (((NonLeafNode*)rootPage)->pageNoArray[0] == 0);
+	bufMgr->unPinPage(file, index->rootPageNum, false);
+	if(emptyTree) {
+		return false;
+	}
+
+	// the root is never rebalanced, it only shrinks
+	bool underflow = false;
+	if(!deleteRecursive(index->rootPageNum, key, rid, 0, underflow)) {
+		return false;
+	}
+
+	shrinkRoot();
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::deleteRange
+// -----------------------------------------------------------------------------
+
+/*
+The first and the last leaf that may hold entries of the range are found with one descent each, remembering
+the path. Every leaf strictly between them holds only entries of the range. Below the node where the two paths
+part, the subtrees between the paths are freed without reading their leaves' entries and are cut out of the
+nodes on the paths. The two boundary leaves are trimmed and linked to each other, which repairs the leaf level
+in one step. Finally the nodes around the gap are rebalanced, see rebalanceGap.
+*/
+
+template <class Traits>
+void BTreeCore<Traits>::deleteRange(const void* lowValParm, const Operator lowOpParm,
+                                    const void* highValParm, const Operator highOpParm) {
+	// check op
+	if((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+
+	// if lowVal > highVal throw exception
+	KeyType lowKey;
+	KeyType highKey;
+	Traits::load(lowValParm, lowKey);
+	Traits::load(highValParm, highKey);
+	if(highKey < lowKey) throw BadScanrangeException();
+	TreeLock lock(index->latches);
+	deleteRangeExclusive(lowKey, lowOpParm, highKey, highOpParm);
+}
+
+template <class Traits>
+void BTreeCore<Traits>::deleteRangeExclusive(const KeyType & lowKey, const Operator lowOp, const KeyType & highKey,
+                                             const Operator highOp) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// empty tree
+	Page* page;
+	bufMgr->readPage(file, index->rootPageNum, page);
+	const bool emptyTree = (((NonLeafNode*)page)->pageNoArray[0] == 0);
+	bufMgr->unPinPage(file, index->rootPageNum, false);
+	if(emptyTree) {
+		return;
+	}
+
+	std::vector<PathStep> leftPath;
+	std::vector<PathStep> rightPath;
+	const PageId leftLeafId = findLeaf(lowKey, lowOp == GTE, &leftPath);
+	const PageId rightLeafId = findLeaf(highKey, highOp == LT, &rightPath);
+	const int depth = leftPath.size();
+
+	// range inside one leaf
+	if(leftLeafId == rightLeafId) {
+		bufMgr->readPage(file, leftLeafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		KeyType* keys = keysOf(leaf);
+		const int n = leaf->keyArrLength;
+		const int begin = (lowOp == GTE) ? Traits::lowerBound(keys, n, lowKey) : Traits::upperBound(keys, n, lowKey);
+		const int end = (highOp == LT) ? Traits::lowerBound(keys, n, highKey) : Traits::upperBound(keys, n, highKey);
+		if(end > begin) {
+			memmove(&keys[begin], &keys[end], (n - end) * sizeof(KeyType));
+			memmove(&leaf->ridArray[begin], &leaf->ridArray[end], (n - end) * sizeof(RecordId));
+			movePayloads(leaf, begin, leaf, end, n - end);
+			leaf->keyArrLength = n - (end - begin);
+		}
+		bufMgr->unPinPage(file, leftLeafId, end > begin);
+		rebalanceGap(lowKey, lowOp == GTE);
+		return;
+	}
+
+	// node where the paths part, the children between them go
+	int split = 0;
+	while(leftPath[split].child == rightPath[split].child) split ++;
+	{
+		bufMgr->readPage(file, leftPath[split].pageNo, page);
+		NonLeafNode* node = (NonLeafNode*)page;
+		const int first = leftPath[split].child;
+		const int last = rightPath[split].child;
+		const int n = node->keyArrLength;
+		for(int i = first + 1; i < last; i ++) {
+			freeSubtree(node->pageNoArray[i], node->level == 1);
+		}
+		// keys[last - 1] is kept as the separator of the two remaining children
+		memmove(&keysOf(node)[first], &keysOf(node)[last - 1], (n - last + 1) * sizeof(KeyType));
+		memmove(&node->pageNoArray[first + 1], &node->pageNoArray[last], (n - last + 1) * sizeof(PageId));
+		node->keyArrLength = n - (last - first - 1);
+		rightPath[split].child = first + 1;
+		bufMgr->unPinPage(file, leftPath[split].pageNo, true);
+	}
+
+	// below it, everything right of the left path and left of the right path goes
+	for(int k = split + 1; k < depth; k ++) {
+		bufMgr->readPage(file, leftPath[k].pageNo, page);
+		NonLeafNode* node = (NonLeafNode*)page;
+		const int first = leftPath[k].child;
+		for(int i = first + 1; i <= node->keyArrLength; i ++) {
+			freeSubtree(node->pageNoArray[i], node->level == 1);
+		}
+		node->keyArrLength = first;
+		bufMgr->unPinPage(file, leftPath[k].pageNo, true);
+
+		bufMgr->readPage(file, rightPath[k].pageNo, page);
+		node = (NonLeafNode*)page;
+		const int last = rightPath[k].child;
+		const int n = node->keyArrLength;
+		for(int i = 0; i < last; i ++) {
+			freeSubtree(node->pageNoArray[i], node->level == 1);
+		}
+		memmove(keysOf(node), &keysOf(node)[last], (n - last) * sizeof(KeyType));
+		memmove(node->pageNoArray, &node->pageNoArray[last], (n - last + 1) * sizeof(PageId));
+		node->keyArrLength = n - last;
+		rightPath[k].child = 0;
+		bufMgr->unPinPage(file, rightPath[k].pageNo, true);
+	}
+
+	// trim the boundary leaves and link them
+	bufMgr->readPage(file, leftLeafId, page);
+	LeafNode* leftLeaf = (LeafNode*)page;
+	leftLeaf->keyArrLength = (lowOp == GTE) ?
+		Traits::lowerBound(keysOf(leftLeaf), leftLeaf->keyArrLength, lowKey) :
+		Traits::upperBound(keysOf(leftLeaf), leftLeaf->keyArrLength, lowKey);
+	leftLeaf->rightSibPageNo = rightLeafId;
+	bufMgr->unPinPage(file, leftLeafId, true);
+
+	bufMgr->readPage(file, rightLeafId, page);
+	LeafNode* rightLeaf = (LeafNode*)page;
+	rightLeaf->leftSibPageNo = leftLeafId;
+	const int n = rightLeaf->keyArrLength;
+	const int end = (highOp == LT) ? Traits::lowerBound(keysOf(rightLeaf), n, highKey) :
+	                                     Traits::upperBound(keysOf(rightLeaf), n, highKey);
+	memmove(keysOf(rightLeaf), &keysOf(rightLeaf)[end], (n - end) * sizeof(KeyType));
+	memmove(rightLeaf->ridArray, &rightLeaf->ridArray[end], (n - end) * sizeof(RecordId));
+	movePayloads(rightLeaf, 0, rightLeaf, end, n - end);
+	rightLeaf->keyArrLength = n - end;
+	bufMgr->unPinPage(file, rightLeafId, true);
+
+	rebalanceGap(lowKey, lowOp == GTE);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::rebalanceGap
+// -----------------------------------------------------------------------------
+
+/*
+After a range delete only the two leaves next to the gap and the nodes above them can be less than half full,
+every other node either was not touched or was balanced with one of them. Any key between the entries left of
+the gap and those right of it leads to one of the two leaves, the other one is its left or right sibling. So
+the paths to the leaf for the low key and to both of its siblings are rebalanced bottom-up like deleteEntry
+does it. A node the range delete left without keys cannot balance its child; it is merged with a sibling or
+takes keys from one one level up, and the child is balanced in the next round. The rounds stop when nothing
+changes any more, each one either merges two nodes or leaves one less node underflowing.
+*/
+
+template <class Traits>
+void BTreeCore<Traits>::rebalanceGap(const KeyType & key, const bool lower) {
+	bool changed = true;
+	while(changed) {
+		changed = false;
+		for(int side = -1; side <= 1; side ++) {
+			std::vector<PathStep> path;
+			findLeaf(key, lower, &path);
+			if(side != 0 && !siblingPath(path, side > 0)) {
+				continue;
+			}
+			for(int k = path.size() - 1; k >= 0; k --) {
+				if(fixUnderflow(path[k].pageNo, path[k].child)) changed = true;
+			}
+			shrinkRoot();
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::siblingPath
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::siblingPath(std::vector<PathStep> & path, const bool right) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// deepest node on the path with a child next to the path on that side
+	Page* page;
+	int k = path.size() - 1;
+	for(; k >= 0; k --) {
+		bufMgr->readPage(file, path[k].pageNo, page);
+		const int n = ((NonLeafNode*)page)->keyArrLength;
+		bufMgr->unPinPage(file, path[k].pageNo, false);
+		if(right ? path[k].child < n : path[k].child > 0) break;
+	}
+	if(k < 0) {
+		return false;
+	}
+	path.resize(k + 1);
+	path[k].child += right ? 1 : -1;
+
+	// down along the edge of the subtree facing the path
+	bufMgr->readPage(file, path[k].pageNo, page);
+	NonLeafNode* node = (NonLeafNode*)page;
+	while(node->level != 1) {
+		const PageId nodeId = path.back().pageNo;
+		const PageId childId = node->pageNoArray[path.back().child];
+		bufMgr->unPinPage(file, nodeId, false);
+		bufMgr->readPage(file, childId, page);
+		node = (NonLeafNode*)page;
+		PathStep step = {childId, right ? 0 : node->keyArrLength, 0, node->keyArrLength};
+		path.push_back(step);
+	}
+	bufMgr->unPinPage(file, path.back().pageNo, false);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::shrinkRoot
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::shrinkRoot() {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// root without keys above another non leaf, its only child becomes the root
+	const PageId oldRootId = index->rootPageNum;
+	Page* rootPage;
+	bufMgr->readPage(file, index->rootPageNum, rootPage);
+	NonLeafNode* root = (NonLeafNode*)rootPage;
+	while(root->keyArrLength == 0 && root->level == 0) {
+		const PageId emptyRootId = index->rootPageNum;
+		index->rootPageNum = root->pageNoArray[0];
+		bufMgr->unPinPage(file, emptyRootId, false);
+		freeNode(emptyRootId);
+		bufMgr->readPage(file, index->rootPageNum, rootPage);
+		root = (NonLeafNode*)rootPage;
+	}
+	bufMgr->unPinPage(file, index->rootPageNum, false);
+	if(index->rootPageNum == oldRootId) {
+		return;
+	}
+
+	// set index meta page
+	Page* headerPage;
+	bufMgr->readPage(file, index->headerPageNum, headerPage);
+	((IndexMetaInfo*)headerPage)->rootPageNo = index->rootPageNum;
+	bufMgr->unPinPage(file, index->headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::fixUnderflow
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::fixUnderflow(const PageId nodeId, const int child) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	Page* page;
+	bufMgr->readPage(file, nodeId, page);
+	NonLeafNode* node = (NonLeafNode*)page;
+	const PageId childId = node->pageNoArray[child];
+	Page* childPage;
+	bufMgr->readPage(file, childId, childPage);
+	const bool underflow = (node->level == 1) ?
+		((LeafNode*)childPage)->keyArrLength < index->leafOccupancy / 2 :
+		((NonLeafNode*)childPage)->keyArrLength < index->nodeOccupancy / 2;
+	bufMgr->unPinPage(file, childId, false);
+	const bool balanced = underflow && rebalance(node, child);
+	bufMgr->unPinPage(file, nodeId, balanced);
+	return balanced;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::freeSubtree
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::freeSubtree(const PageId nodeId, const bool isLeaf) {
+	if(!isLeaf) {
+		Page* page;
+		index->bufMgr->readPage(index->file, nodeId, page);
+		NonLeafNode* node = (NonLeafNode*)page;
+		for(int i = 0; i <= node->keyArrLength; i ++) {
+			freeSubtree(node->pageNoArray[i], node->level == 1);
+		}
+		index->bufMgr->unPinPage(index->file, nodeId, false);
+	}
+	freeNode(nodeId);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::deleteRecursive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::deleteRecursive(const PageId nodeId, const KeyType & key, const RecordId rid,
+                                        const int lastLevel, bool & underflow) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	Page* page;
+	bufMgr->readPage(file, nodeId, page);
+
+	// is a leaf, remove the entry if it is among the equal keys here
+	if(lastLevel == 1) {
+		LeafNode* leaf = (LeafNode*)page;
+		KeyType* keys = keysOf(leaf);
+		const int n = leaf->keyArrLength;
+		int i = Traits::lowerBound(keys, n, key);
+		while(i < n && !(key < keys[i]) && leaf->ridArray[i] != rid) i ++;
+		if(i == n || key < keys[i]) {
+			bufMgr->unPinPage(file, nodeId, false);
+			return false;
+		}
+		removeFromLeaf(leaf, i);
+		underflow = (leaf->keyArrLength < index->leafOccupancy / 2);
+		bufMgr->unPinPage(file, nodeId, true);
+		return true;
+	}
+
+	// not a leaf, equal keys can be in any child from the leftmost to the rightmost one that may hold key.
+	// The node stays pinned, an underflowing child is rebalanced with its sibling right away
+	NonLeafNode* node = (NonLeafNode*)page;
+	const int first = Traits::lowerBound(keysOf(node), node->keyArrLength, key);
+	const int last = Traits::upperBound(keysOf(node), node->keyArrLength, key);
+	for(int child = first; child <= last; child ++) {
+		bool childUnderflow = false;
+		if(!deleteRecursive(node->pageNoArray[child], key, rid, node->level, childUnderflow)) {
+			continue;
+		}
+		if(childUnderflow) {
+			rebalance(node, child);
+		}
+		underflow = (node->keyArrLength < index->nodeOccupancy / 2);
+		bufMgr->unPinPage(file, nodeId, childUnderflow);
+		return true;
+	}
+	bufMgr->unPinPage(file, nodeId, false);
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::rebalance -- borrow from or merge with a sibling
+// -----------------------------------------------------------------------------
+
+/*
+An underflowing child is balanced with its left sibling, or with its right sibling if it is the first child.
+If the two nodes together hold enough entries for both to be at least half full, the entries are spread evenly
+over them and the separator in the parent is replaced. Otherwise the right node is merged into the left one,
+its page goes on the free list and its separator and page number are removed from the parent. The parent may
+underflow in turn, which its own parent handles on the way up.
+*/
+
+template <class Traits>
+bool BTreeCore<Traits>::rebalance(NonLeafNode* node, const int child) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	// only child of the root, nothing to balance with
+	const int n = node->keyArrLength;
+	if(n == 0) {
+		return false;
+	}
+
+	const int left = (child > 0) ? child - 1 : child;
+	const int right = left + 1;
+	const PageId leftId = node->pageNoArray[left];
+	const PageId rightId = node->pageNoArray[right];
+	Page* leftPage;
+	Page* rightPage;
+	bufMgr->readPage(file, leftId, leftPage);
+	bufMgr->readPage(file, rightId, rightPage);
+
+	KeyType & separator = keysOf(node)[left];
+	const bool merged = (node->level == 1) ?
+		balanceLeaves((LeafNode*)leftPage, (LeafNode*)rightPage, separator) :
+		balanceNonLeaves((NonLeafNode*)leftPage, (NonLeafNode*)rightPage, separator);
+	if(merged && node->level == 1) {
+		setLeftSibling(((LeafNode*)leftPage)->rightSibPageNo, leftId);
+	}
+	bufMgr->unPinPage(file, leftId, true);
+	bufMgr->unPinPage(file, rightId, true);
+	if(!merged) {
+		return true;
+	}
+
+	// right node is gone, drop its separator and page number
+	KeyType* keys = keysOf(node);
+	PageId* pages = node->pageNoArray;
+	memmove(&keys[left], &keys[left + 1], (n - 1 - left) * sizeof(KeyType));
+	memmove(&pages[right], &pages[right + 1], (n - right) * sizeof(PageId));
+	node->keyArrLength = n - 1;
+	freeNode(rightId);
+	return true;
+}
+
+template <class Traits>
+bool BTreeCore<Traits>::balanceLeaves(LeafNode* leftNode, LeafNode* rightNode, KeyType & separator) {
+	const int a = leftNode->keyArrLength;
+	const int b = rightNode->keyArrLength;
+	KeyType* leftKeys = keysOf(leftNode);
+	KeyType* rightKeys = keysOf(rightNode);
+	RecordId* leftRids = leftNode->ridArray;
+	RecordId* rightRids = rightNode->ridArray;
+
+	// merge, the right leaf is unlinked from the leaf level
+	if(a + b < 2 * (index->leafOccupancy / 2)) {
+		memcpy(&leftKeys[a], rightKeys, b * sizeof(KeyType));
+		memcpy(&leftRids[a], rightRids, b * sizeof(RecordId));
+		movePayloads(leftNode, a, rightNode, 0, b);
+		leftNode->keyArrLength = a + b;
+		leftNode->rightSibPageNo = rightNode->rightSibPageNo;
+		return true;
+	}
+
+	// redistribute, the new separator goes between the last key of the left and the first key of the right leaf
+	const int leftCnt = (a + b) / 2;
+	if(a > leftCnt) {
+		const int k = a - leftCnt;
+		memmove(&rightKeys[k], rightKeys, b * sizeof(KeyType));
+		memmove(&rightRids[k], rightRids, b * sizeof(RecordId));
+		movePayloads(rightNode, k, rightNode, 0, b);
+		memcpy(rightKeys, &leftKeys[leftCnt], k * sizeof(KeyType));
+		memcpy(rightRids, &leftRids[leftCnt], k * sizeof(RecordId));
+		movePayloads(rightNode, 0, leftNode, leftCnt, k);
+	} else {
+		const int k = leftCnt - a;
+		memcpy(&leftKeys[a], rightKeys, k * sizeof(KeyType));
+		memcpy(&leftRids[a], rightRids, k * sizeof(RecordId));
+		movePayloads(leftNode, a, rightNode, 0, k);
+		memmove(rightKeys, &rightKeys[k], (b - k) * sizeof(KeyType));
+		memmove(rightRids, &rightRids[k], (b - k) * sizeof(RecordId));
+		movePayloads(rightNode, 0, rightNode, k, b - k);
+	}
+	leftNode->keyArrLength = leftCnt;
+	rightNode->keyArrLength = a + b - leftCnt;
+	separator = Traits::separator(leftKeys[leftCnt - 1], rightKeys[0]);
+	return false;
+}
+
+template <class Traits>
+bool BTreeCore<Traits>::balanceNonLeaves(NonLeafNode* leftNode, NonLeafNode* rightNode, KeyType & separator) {
+	const int a = leftNode->keyArrLength;
+	const int b = rightNode->keyArrLength;
+	KeyType* leftKeys = keysOf(leftNode);
+	KeyType* rightKeys = keysOf(rightNode);
+	PageId* leftPages = leftNode->pageNoArray;
+	PageId* rightPages = rightNode->pageNoArray;
+
+	// merge, the separator comes down between the keys of both nodes
+	if(a + b < 2 * (index->nodeOccupancy / 2)) {
+		leftKeys[a] = separator;
+		memcpy(&leftKeys[a + 1], rightKeys, b * sizeof(KeyType));
+		memcpy(&leftPages[a + 1], rightPages, (b + 1) * sizeof(PageId));
+		leftNode->keyArrLength = a + b + 1;
+		return true;
+	}
+
+	// redistribute, keys rotate through the separator
+	const int leftCnt = (a + b) / 2;
+	if(a > leftCnt) {
+		const int k = a - leftCnt;
+		memmove(&rightKeys[k], rightKeys, b * sizeof(KeyType));
+		memmove(&rightPages[k], rightPages, (b + 1) * sizeof(PageId));
+		rightKeys[k - 1] = separator;
+		memcpy(rightKeys, &leftKeys[leftCnt + 1], (k - 1) * sizeof(KeyType));
+		memcpy(rightPages, &leftPages[leftCnt + 1], k * sizeof(PageId));
+		separator = leftKeys[leftCnt];
+	} else if(a < leftCnt) {
+		const int k = leftCnt - a;
+		leftKeys[a] = separator;
+		memcpy(&leftKeys[a + 1], rightKeys, (k - 1) * sizeof(KeyType));
+		memcpy(&leftPages[a + 1], rightPages, k * sizeof(PageId));
+		separator = rightKeys[k - 1];
+		memmove(rightKeys, &rightKeys[k], (b - k) * sizeof(KeyType));
+		memmove(rightPages, &rightPages[k], (b + 1 - k) * sizeof(PageId));
+	}
+	leftNode->keyArrLength = leftCnt;
+	rightNode->keyArrLength = a + b - leftCnt;
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::allocNode / freeNode -- pages of the index file
+// -----------------------------------------------------------------------------
+
+/*
+BlobFile cannot give pages back, so pages of deleted nodes are kept on a free list and reused for new nodes.
+The list is linked through the first bytes of the free pages, its head is freePageNum of the index and
+freePageNo of the meta page.
+*/
+
+template <class Traits>
+void BTreeCore<Traits>::allocNode(PageId & pageNo, Page* & page) {
+	std::lock_guard<std::mutex> lock(index->freeListMutex);
+	if(index->freePageNum == 0) {
+		index->bufMgr->allocPage(index->file, pageNo, page);
+		return;
+	}
+	pageNo = index->freePageNum;
+	index->bufMgr->readPage(index->file, pageNo, page);
+	setFreePageNum(*(PageId*)page);
+}
+
+template <class Traits>
+void BTreeCore<Traits>::freeNode(const PageId pageNo) {
+	std::lock_guard<std::mutex> lock(index->freeListMutex);
+	Page* page;
+	index->bufMgr->readPage(index->file, pageNo, page);
+	*(PageId*)page = index->freePageNum;
+	index->bufMgr->unPinPage(index->file, pageNo, true);
+	setFreePageNum(pageNo);
+}
+
+template <class Traits>
+void BTreeCore<Traits>::setFreePageNum(const PageId pageNo) {
+	index->freePageNum = pageNo;
+	Page* headerPage;
+	index->bufMgr->readPage(index->file, index->headerPageNum, headerPage);
+	((IndexMetaInfo*)headerPage)->freePageNo = pageNo;
+	index->bufMgr->unPinPage(index->file, index->headerPageNum, true);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::startScan
+// -----------------------------------------------------------------------------
+
+/*
+Cursors keep their current leaf pinned but hold no latch on it. Every entry is copied out of the leaf first and
+the leaf is validated afterwards. If a writer changed the leaf meanwhile, the cursor finds its place again from
+the last key it returned: it seeks the first entry with that key (the last one in a reverse scan) and skips as
+many entries with that key as it has returned in a row. Entries inserted or deleted in that run of equal keys
+while the cursor was away shift it by as many entries, like any other change made during a scan.
+*/
+
+template <class Traits>
+bool BTreeCore<Traits>::startScan(IndexCursor & cursor, const void* lowValParm, const Operator lowOpParm,
+                                  const void* highValParm, const Operator highOpParm, const bool reverse) {
+	// check op
+	if((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+
+	// if lowVal > highVal throw exception
+	KeyType lowKey;
+	KeyType highKey;
+	Traits::load(lowValParm, lowKey);
+	Traits::load(highValParm, highKey);
+	if(highKey < lowKey) throw BadScanrangeException();
+
+	// end scan that is still running
+	if(cursor.scanExecuting) {
+		cursor.endScan();
+	}
+	*(KeyType*)cursor.highVal = highKey;
+	*(KeyType*)cursor.lowVal = lowKey;
+	cursor.lowOp = lowOpParm;
+	cursor.highOp = highOpParm;
+	cursor.reverse = reverse;
+	cursor.readAheadIn = 1;
+	cursor.readAheadWindow = MINREADAHEAD;
+	cursor.lastKeyCount = 0;
+	cursor.skipCount = 0;
+
+	// forward scans start at the first entry not below lowVal, reverse scans at the last one not above highVal
+	if(!seek(cursor, reverse ? highKey : lowKey, reverse ? highOpParm == LT : lowOpParm == GT)) {
+		return false;
+	}
+
+	if(reverse) {
+		// all keys of the leaf are too large, scan starts at the next leaf on the left holding any entry
+		while(cursor.currentPageData != NULL && cursor.nextEntry < 0) {
+			if(!moveToLeftSibling(cursor)) {
+				index->bufMgr->unPinPage(index->file, cursor.currentPageNum, false);
+				return false;
+			}
+		}
+	} else if(cursor.nextEntry >= lengthOf((LeafNode*)cursor.currentPageData)) {
+		// all keys of the leaf are too small, scan starts at the right sibling
+		if(!moveToRightSibling(cursor)) {
+			index->bufMgr->unPinPage(index->file, cursor.currentPageNum, false);
+			return false;
+		}
+	}
+	if(cursor.currentPageData == NULL) {
+		return false;
+	}
+	cursor.scanExecuting = true;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::seek
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::seek(IndexCursor & cursor, const KeyType & key, const bool after) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	// the leftmost leaf that may hold key if entries equal to key are to come next in scan order
+	const bool lower = cursor.reverse ? after : !after;
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t leafVersion;
+		if(!findLeafOptimistic(key, lower, treeVersion, leafId, leafVersion)) continue;
+		if(leafId == 0) {
+			if(!latches.tree().validate(treeVersion)) continue;
+			cursor.currentPageData = NULL;
+			return false;
+		}
+
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int len = lengthOf(leaf);
+		int pos = lower ? Traits::lowerBound(keysOf(leaf), len, key) : Traits::upperBound(keysOf(leaf), len, key);
+		if(cursor.reverse) pos --;
+		if(!validate(leafId, leafVersion, treeVersion)) {
+			bufMgr->unPinPage(file, leafId, false);
+			continue;
+		}
+		cursor.nextEntry = pos;
+		cursor.currentPageNum = leafId;
+		cursor.currentPageData = page;
+		cursor.leafVersion = leafVersion;
+		cursor.treeVersion = treeVersion;
+		return true;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::reposition
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::reposition(IndexCursor & cursor) {
+	if(cursor.currentPageData != NULL) {
+		index->bufMgr->unPinPage(index->file, cursor.currentPageNum, false);
+		cursor.currentPageData = NULL;
+	}
+
+	// nothing returned yet, start again at the bound of the scan
+	if(cursor.lastKeyCount == 0) {
+		if(cursor.reverse) {
+			seek(cursor, highValOf(cursor), cursor.highOp == LT);
+		} else {
+			seek(cursor, lowValOf(cursor), cursor.lowOp == GT);
+		}
+		cursor.skipCount = 0;
+		return;
+	}
+	seek(cursor, lastKeyOf(cursor), false);
+	cursor.skipCount = cursor.lastKeyCount;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::skipEqual / noteReturned
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::skipEqual(IndexCursor & cursor, const KeyType & key) {
+	if(cursor.skipCount == 0) {
+		return false;
+	}
+	const KeyType & lastKey = lastKeyOf(cursor);
+	if(key < lastKey || lastKey < key) {
+		// fewer entries with the last key than were returned, some of them were deleted
+		cursor.skipCount = 0;
+		return false;
+	}
+	cursor.skipCount --;
+	return true;
+}
+
+template <class Traits>
+void BTreeCore<Traits>::noteReturned(IndexCursor & cursor, const KeyType & key, const int count) {
+	const KeyType & lastKey = lastKeyOf(cursor);
+	if(cursor.lastKeyCount > 0 && !(key < lastKey) && !(lastKey < key)) {
+		cursor.lastKeyCount += count;
+		return;
+	}
+	*(KeyType*)cursor.lastKey = key;
+	cursor.lastKeyCount = count;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::scanNext
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::scanNext(IndexCursor & cursor, RecordId& outRid, void* outPayload) {
+	if(cursor.reverse) {
+		return scanPrev(cursor, outRid, outPayload);
+	}
+	const KeyType & highKey = highValOf(cursor);
+	while(cursor.currentPageData != NULL) {
+		LeafNode* leaf = (LeafNode*)cursor.currentPageData;
+
+		// current leaf is used up, move on to the right sibling
+		if(cursor.nextEntry >= lengthOf(leaf)) {
+			if(!moveToRightSibling(cursor)) {
+				return false;
+			}
+			continue;
+		}
+
+		const KeyType key = keysOf(leaf)[cursor.nextEntry];
+		const RecordId rid = leaf->ridArray[cursor.nextEntry];
+		if(outPayload != NULL) {
+			memcpy(outPayload, payloadsOf(leaf) + cursor.nextEntry * index->payloadSize, index->payloadSize);
+		}
+		if(!cursorValid(cursor)) {
+			reposition(cursor);
+			continue;
+		}
+		if(skipEqual(cursor, key)) {
+			cursor.nextEntry ++;
+			continue;
+		}
+		if(cursor.highOp == LT ? !(key < highKey) : highKey < key) {
+			return false;
+		}
+		outRid = rid;
+		cursor.nextEntry ++;
+		noteReturned(cursor, key, 1);
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::scanNextBatch
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+std::size_t BTreeCore<Traits>::scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids,
+                                             void* outPayloads) {
+	if(cursor.reverse) {
+		return scanPrevBatch(cursor, outRids, maxRids, outPayloads);
+	}
+	const KeyType & highKey = highValOf(cursor);
+	const std::size_t payloadSize = index->payloadSize;
+	std::size_t cnt = 0;
+	while(cnt < maxRids && cursor.currentPageData != NULL) {
+		// entries left to skip after the cursor found its place again go one at a time
+		if(cursor.skipCount > 0) {
+			if(!scanNext(cursor, outRids[cnt], outPayloads == NULL ? NULL : (char*)outPayloads + cnt * payloadSize)) {
+				break;
+			}
+			cnt ++;
+			continue;
+		}
+
+		LeafNode* leaf = (LeafNode*)cursor.currentPageData;
+		const int len = lengthOf(leaf);
+		if(cursor.nextEntry >= len) {
+			if(!moveToRightSibling(cursor)) break;
+			continue;
+		}
+
+		// end of the qualifying slice of this leaf, the whole rest of the leaf if its last key is in range
+		const KeyType* keys = keysOf(leaf);
+		const bool lastInRange = (cursor.highOp == LT) ? keys[len - 1] < highKey : !(highKey < keys[len - 1]);
+		int end = len;
+		if(!lastInRange) {
+			end = (cursor.highOp == LT) ? Traits::lowerBound(keys, len, highKey) :
+			                              Traits::upperBound(keys, len, highKey);
+		}
+
+		// copy the slice out, it only counts once the leaf is validated
+		const int start = cursor.nextEntry;
+		const std::size_t take = (end > start) ? std::min<std::size_t>(end - start, maxRids - cnt) : 0;
+		memcpy(&outRids[cnt], &leaf->ridArray[start], take * sizeof(RecordId));
+		if(outPayloads != NULL) {
+			memcpy((char*)outPayloads + cnt * payloadSize, payloadsOf(leaf) + start * payloadSize, take * payloadSize);
+		}
+		KeyType lastKey;
+		int equal = 0;
+		if(take > 0) {
+			lastKey = keys[start + take - 1];
+			equal = take - Traits::lowerBound(&keys[start], take, lastKey);
+		}
+		if(!cursorValid(cursor)) {
+			reposition(cursor);
+			continue;
+		}
+		if(take == 0) break;
+		noteReturned(cursor, lastKey, equal);
+		cursor.nextEntry += take;
+		cnt += take;
+
+		// range ends inside this leaf
+		if(cursor.nextEntry == end && end < len) break;
+	}
+	return cnt;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::scanPrev
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::scanPrev(IndexCursor & cursor, RecordId& outRid, void* outPayload) {
+	const KeyType & lowKey = lowValOf(cursor);
+	while(cursor.currentPageData != NULL) {
+		// current leaf is used up, move on to the left sibling
+		if(cursor.nextEntry < 0) {
+			if(!moveToLeftSibling(cursor)) {
+				return false;
+			}
+			continue;
+		}
+		LeafNode* leaf = (LeafNode*)cursor.currentPageData;
+
+		const KeyType key = keysOf(leaf)[cursor.nextEntry];
+		const RecordId rid = leaf->ridArray[cursor.nextEntry];
+		if(outPayload != NULL) {
+			memcpy(outPayload, payloadsOf(leaf) + cursor.nextEntry * index->payloadSize, index->payloadSize);
+		}
+		if(!cursorValid(cursor)) {
+			reposition(cursor);
+			continue;
+		}
+		if(skipEqual(cursor, key)) {
+			cursor.nextEntry --;
+			continue;
+		}
+		if(cursor.lowOp == GT ? !(lowKey < key) : key < lowKey) {
+			return false;
+		}
+		outRid = rid;
+		cursor.nextEntry --;
+		noteReturned(cursor, key, 1);
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::scanPrevBatch
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+std::size_t BTreeCore<Traits>::scanPrevBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids,
+                                             void* outPayloads) {
+	const KeyType & lowKey = lowValOf(cursor);
+	const std::size_t payloadSize = index->payloadSize;
+	std::size_t cnt = 0;
+	while(cnt < maxRids && cursor.currentPageData != NULL) {
+		// entries left to skip after the cursor found its place again go one at a time
+		if(cursor.skipCount > 0) {
+			if(!scanPrev(cursor, outRids[cnt], outPayloads == NULL ? NULL : (char*)outPayloads + cnt * payloadSize)) {
+				break;
+			}
+			cnt ++;
+			continue;
+		}
+		if(cursor.nextEntry < 0) {
+			if(!moveToLeftSibling(cursor)) break;
+			continue;
+		}
+		LeafNode* leaf = (LeafNode*)cursor.currentPageData;
+
+		// start of the qualifying slice of the entries left to return, all of them if the first key is in range
+		const KeyType* keys = keysOf(leaf);
+		const int len = std::min(cursor.nextEntry + 1, lengthOf(leaf));
+		int begin = 0;
+		if(len > 0) {
+			const bool firstInRange = (cursor.lowOp == GT) ? lowKey < keys[0] : !(keys[0] < lowKey);
+			if(!firstInRange) {
+				begin = (cursor.lowOp == GT) ? Traits::upperBound(keys, len, lowKey) :
+				                               Traits::lowerBound(keys, len, lowKey);
+			}
+		}
+
+		// copy the slice from its end backwards so rids come out in descending key order, it only counts once
+		// the leaf is validated
+		const std::size_t take = (len > begin) ? std::min<std::size_t>(len - begin, maxRids - cnt) : 0;
+		for(std::size_t i = 0; i < take; i ++) {
+			const int pos = len - 1 - (int)i;
+			outRids[cnt + i] = leaf->ridArray[pos];
+			if(outPayloads != NULL) {
+				memcpy((char*)outPayloads + (cnt + i) * payloadSize, payloadsOf(leaf) + pos * payloadSize, payloadSize);
+			}
+		}
+		KeyType lastKey;
+		int equal = 0;
+		if(take > 0) {
+			const int first = len - take;
+			lastKey = keys[first];
+			equal = Traits::upperBound(&keys[first], take, lastKey);
+		}
+		if(!cursorValid(cursor)) {
+			reposition(cursor);
+			continue;
+		}
+		if(take == 0) break;
+		noteReturned(cursor, lastKey, equal);
+		cursor.nextEntry -= take;
+		cnt += take;
+
+		// range ends inside this leaf
+		if(cursor.nextEntry == begin - 1 && begin > 0) break;
+	}
+	return cnt;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::lookup
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+std::size_t BTreeCore<Traits>::lookup(const void* keyParm, std::vector<RecordId> & outRids) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	KeyType key;
+	Traits::load(keyParm, key);
+	outRids.clear();
+
+	// equal keys start in the leftmost leaf that may hold key and can run on into its right siblings
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t leafVersion;
+		if(!findLeafOptimistic(key, true, treeVersion, leafId, leafVersion)) continue;
+		if(leafId == 0) {
+			if(latches.tree().validate(treeVersion)) return 0;
+			continue;
+		}
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		const bool valid = collectEqual((LeafNode*)page, leafId, leafVersion, treeVersion, key, outRids);
+		bufMgr->unPinPage(file, leafId, false);
+		if(valid) return outRids.size();
+	}
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::lookupBatch
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+std::size_t BTreeCore<Traits>::lookupBatch(const void* keys, const std::size_t n,
+                                           std::vector<std::vector<RecordId> > & results) {
+	LatchTable & latches = index->latches;
+	results.resize(n);
+	if(n == 0) return 0;
+
+	// sort the probe keys, remembering where each one goes in results
+	std::vector<Probe> probes(n);
+	for(std::size_t i = 0; i < n; i ++) {
+		Traits::load((const char*)keys + i * sizeof(KeyType), probes[i].key);
+		probes[i].pos = i;
+	}
+	std::sort(probes.begin(), probes.end(), [](const Probe & a, const Probe & b) { return a.key < b.key; });
+
+	// a node changed under the batch, it starts over from the root
+	while(true) {
+		for(std::size_t i = 0; i < n; i ++) results[i].clear();
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		const PageId rootId = index->rootPageNum;
+		const std::uint64_t rootVersion = latches.node(rootId).readLock();
+		if(!latches.tree().validate(treeVersion)) continue;
+		if(lookupBatchRecursive(rootId, rootVersion, treeVersion, false, &probes[0], n, results)) break;
+	}
+
+	std::size_t total = 0;
+	for(std::size_t i = 0; i < n; i ++) total += results[i].size();
+	return total;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::lookupBatchRecursive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::lookupBatchRecursive(const PageId nodeId, const std::uint64_t version,
+                                             const std::uint64_t treeVersion, const bool isLeaf,
+                                             const Probe* probes, const std::size_t n,
+                                             std::vector<std::vector<RecordId> > & results) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	Page* page;
+	bufMgr->readPage(file, nodeId, page);
+
+	if(isLeaf) {
+		LeafNode* leaf = (LeafNode*)page;
+		for(std::size_t i = 0; i < n; i ++) {
+			// repeated probe key, share the result of the previous one
+			if(i > 0 && !(probes[i - 1].key < probes[i].key)) {
+				results[probes[i].pos] = results[probes[i - 1].pos];
+				continue;
+			}
+			if(!collectEqual(leaf, nodeId, version, treeVersion, probes[i].key, results[probes[i].pos])) {
+				bufMgr->unPinPage(file, nodeId, false);
+				return false;
+			}
+		}
+		bufMgr->unPinPage(file, nodeId, false);
+		return true;
+	}
+
+	// hand every run of probe keys that go to the same child down in one call, the child is the leftmost
+	// one that may hold the key and takes all keys up to and including the separator on its right
+	NonLeafNode* node = (NonLeafNode*)page;
+	const KeyType* sepKeys = keysOf(node);
+	const int len = lengthOf(node);
+	const bool childIsLeaf = (node->level == 1);
+	std::size_t first = 0;
+	while(first < n) {
+		const int child = Traits::lowerBound(sepKeys, len, probes[first].key);
+		std::size_t last = first + 1;
+		if(child == len) {
+			last = n;
+		} else {
+			while(last < n && !(sepKeys[child] < probes[last].key)) last ++;
+		}
+
+		// the child is read only once the node is known to be unchanged, an empty tree has no child
+		const PageId childId = node->pageNoArray[child];
+		bool valid = validate(nodeId, version, treeVersion);
+		if(valid && childId != 0) {
+			const std::uint64_t childVersion = latches.node(childId).readLock();
+			valid = latches.node(nodeId).validate(version) &&
+			        lookupBatchRecursive(childId, childVersion, treeVersion, childIsLeaf, probes + first, last - first,
+			                             results);
+		}
+		if(!valid) {
+			bufMgr->unPinPage(file, nodeId, false);
+			return false;
+		}
+		first = last;
+	}
+	bufMgr->unPinPage(file, nodeId, false);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::collectEqual
+// -----------------------------------------------------------------------------
+
+/*
+Duplicate keys are stored as separate entries unless the index has posting lists, see posting.h. The rids of a
+run of equal keys are contiguous in the rid array of every leaf the run spans, so the run is copied as one block
+per leaf. Each leaf is validated after its block is copied and before its right sibling is followed.
+*/
+
+template <class Traits>
+bool BTreeCore<Traits>::collectEqual(LeafNode* leaf, PageId leafId, std::uint64_t version,
+                                     const std::uint64_t treeVersion, const KeyType & key,
+                                     std::vector<RecordId> & outRids) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	const std::size_t found = outRids.size();
+	PageId siblingId = 0;
+	int begin = Traits::lowerBound(keysOf(leaf), lengthOf(leaf), key);
+	bool valid = true;
+	while(true) {
+		const int len = lengthOf(leaf);
+		begin = std::min(begin, len);
+		const int end = (begin == len) ? len : std::max(Traits::upperBound(keysOf(leaf), len, key), begin);
+		outRids.insert(outRids.end(), leaf->ridArray + begin, leaf->ridArray + end);
+
+		// a key greater than key ends the run inside this leaf
+		const PageId rightId = leaf->rightSibPageNo;
+		valid = validate(leafId, version, treeVersion);
+		if(!valid || end < len || rightId == 0) break;
+		const std::uint64_t rightVersion = latches.node(rightId).readLock();
+		valid = latches.node(leafId).validate(version);
+		if(!valid) break;
+		Page* page;
+		bufMgr->readPage(file, rightId, page);
+		if(siblingId != 0) bufMgr->unPinPage(file, siblingId, false);
+		siblingId = rightId;
+		leafId = rightId;
+		version = rightVersion;
+		leaf = (LeafNode*)page;
+		begin = 0;
+	}
+	if(siblingId != 0) bufMgr->unPinPage(file, siblingId, false);
+	if(!valid) outRids.resize(found);
+	return valid;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::findLeaf
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+PageId BTreeCore<Traits>::findLeaf(const KeyType & key, const bool lower, std::vector<PathStep>* path) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+
+	PageId nodeId = index->rootPageNum;
+	Page* page;
+	bufMgr->readPage(file, nodeId, page);
+	while(true) {
+		NonLeafNode* node = (NonLeafNode*)page;
+		const int child = lower ? Traits::lowerBound(keysOf(node), node->keyArrLength, key) :
+		                          Traits::upperBound(keysOf(node), node->keyArrLength, key);
+		const PageId childId = node->pageNoArray[child];
+		if(path != NULL) {
+			PathStep step = {nodeId, child, 0, node->keyArrLength};
+			path->push_back(step);
+		}
+		const bool aboveLeaves = (node->level == 1);
+		bufMgr->unPinPage(file, nodeId, false);
+		nodeId = childId;
+		if(aboveLeaves) break;
+		bufMgr->readPage(file, nodeId, page);
+	}
+	return nodeId;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::findLeafOptimistic
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::findLeafOptimistic(const KeyType & key, const bool lower, const std::uint64_t treeVersion,
+                                           PageId & leafId, std::uint64_t & leafVersion,
+                                           std::vector<PathStep>* path) {
+	BufMgr* bufMgr = index->bufMgr;
+	File* file = index->file;
+	LatchTable & latches = index->latches;
+
+	// the root page number is protected by the tree latch
+	PageId nodeId = index->rootPageNum;
+	std::uint64_t version = latches.node(nodeId).readLock();
+	if(!latches.tree().validate(treeVersion)) return false;
+	while(true) {
+		Page* page;
+		bufMgr->readPage(file, nodeId, page);
+		NonLeafNode* node = (NonLeafNode*)page;
+		const int len = lengthOf(node);
+		const int child = lower ? Traits::lowerBound(keysOf(node), len, key) :
+		                          Traits::upperBound(keysOf(node), len, key);
+		const PageId childId = node->pageNoArray[child];
+		const bool aboveLeaves = (node->level == 1);
+		bufMgr->unPinPage(file, nodeId, false);
+		if(!validate(nodeId, version, treeVersion)) return false;
+		if(path != NULL) {
+			PathStep step = {nodeId, child, version, len};
+			path->push_back(step);
+		}
+
+		// an empty tree has no leaves below the root
+		if(childId == 0) {
+			leafId = 0;
+			return true;
+		}
+		const std::uint64_t childVersion = latches.node(childId).readLock();
+		if(!latches.node(nodeId).validate(version)) return false;
+		nodeId = childId;
+		version = childVersion;
+		if(aboveLeaves) break;
+	}
+	leafId = nodeId;
+	leafVersion = version;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::moveToRightSibling
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::moveToRightSibling(IndexCursor & cursor) {
+	const PageId rightId = ((LeafNode*)cursor.currentPageData)->rightSibPageNo;
+	if(!cursorValid(cursor)) {
+		reposition(cursor);
+		return true;
+	}
+	if(rightId == 0) {
+		return false;
+	}
+
+	// the sibling is still the right sibling when the version of its latch is taken
+	const std::uint64_t rightVersion = index->latches.node(rightId).readLock();
+	if(!cursorValid(cursor)) {
+		reposition(cursor);
+		return true;
+	}
+	Page* rightPage;
+	index->bufMgr->readPage(index->file, rightId, rightPage);
+	index->bufMgr->unPinPage(index->file, cursor.currentPageNum, false);
+	cursor.nextEntry = 0;
+	cursor.currentPageNum = rightId;
+	cursor.currentPageData = rightPage;
+	cursor.leafVersion = rightVersion;
+	readAhead(cursor);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::moveToLeftSibling
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool BTreeCore<Traits>::moveToLeftSibling(IndexCursor & cursor) {
+	const PageId leftId = ((LeafNode*)cursor.currentPageData)->leftSibPageNo;
+	if(!cursorValid(cursor)) {
+		reposition(cursor);
+		return true;
+	}
+	if(leftId == 0) {
+		return false;
+	}
+
+	// the sibling is still the left sibling when the version of its latch is taken
+	const std::uint64_t leftVersion = index->latches.node(leftId).readLock();
+	if(!cursorValid(cursor)) {
+		reposition(cursor);
+		return true;
+	}
+	Page* leftPage;
+	index->bufMgr->readPage(index->file, leftId, leftPage);
+	index->bufMgr->unPinPage(index->file, cursor.currentPageNum, false);
+	cursor.nextEntry = lengthOf((LeafNode*)leftPage) - 1;
+	cursor.currentPageNum = leftId;
+	cursor.currentPageData = leftPage;
+	cursor.leafVersion = leftVersion;
+	readAhead(cursor);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::readAhead
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::readAhead(IndexCursor & cursor) {
+	if(-- cursor.readAheadIn > 0) {
+		return;
+	}
+	cursor.readAheadIn = 1;
+	LeafNode* leaf = (LeafNode*)cursor.currentPageData;
+	const int leafLen = lengthOf(leaf);
+	if(leafLen == 0) {
+		return;
+	}
+
+	// the parent of the leaf lists the leaves that follow, with equal keys spanning leaves the one found may be
+	// a sibling of the current leaf under the same parent. Read-ahead is only a hint, it is skipped if the leaf
+	// or its parent change meanwhile
+	std::vector<PathStep> path;
+	const KeyType key = cursor.reverse ? keysOf(leaf)[leafLen - 1] : keysOf(leaf)[0];
+	PageId leafId;
+	std::uint64_t leafVersion;
+	if(!cursorValid(cursor) ||
+	   !findLeafOptimistic(key, !cursor.reverse, cursor.treeVersion, leafId, leafVersion, &path) || leafId == 0) {
+		return;
+	}
+	const PathStep & parent = path.back();
+	Page* page;
+	index->bufMgr->readPage(index->file, parent.pageNo, page);
+	NonLeafNode* node = (NonLeafNode*)page;
+	const int len = lengthOf(node);
+	int pos = parent.child;
+	const int step = cursor.reverse ? -1 : 1;
+	while(pos >= 0 && pos <= len && node->pageNoArray[pos] != cursor.currentPageNum) pos += step;
+
+	PageId pages[MAXREADAHEAD];
+	int n = 0;
+	bool parentEnd = false;
+	if(pos >= 0 && pos <= len) {
+		for(pos += step; pos >= 0 && pos <= len && n < cursor.readAheadWindow; pos += step) {
+			pages[n ++] = node->pageNoArray[pos];
+		}
+		parentEnd = (pos < 0 || pos > len);
+	}
+	index->bufMgr->unPinPage(index->file, parent.pageNo, false);
+	if(n == 0 || !validate(parent.pageNo, parent.version, cursor.treeVersion)) {
+		return;
+	}
+
+	// read ahead again when half of these leaves are used up, the rest of them is asked for once more then.
+	// If they are the last leaves of the parent, there is nothing more to find from it, the next read-ahead
+	// descends to the parent of the leaf after them
+	index->file->readAhead(pages, n);
+	cursor.readAheadIn = parentEnd ? n + 1 : std::max(n / 2, 1);
+	cursor.readAheadWindow = std::min(cursor.readAheadWindow * 2, MAXREADAHEAD);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeCore::setLeftSibling
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void BTreeCore<Traits>::setLeftSibling(const PageId leafId, const PageId leftId) {
+	if(leafId == 0) {
+		return;
+	}
+	Page* page;
+	index->bufMgr->readPage(index->file, leafId, page);
+	((LeafNode*)page)->leftSibPageNo = leftId;
+	index->bufMgr->unPinPage(index->file, leafId, true);
+}
+
+template class BTreeCore<IntKeyTraits>;
+template class BTreeCore<BigintKeyTraits>;
+template class BTreeCore<UnsignedKeyTraits>;
+template class BTreeCore<UbigintKeyTraits>;
+template class BTreeCore<DoubleKeyTraits>;
+template class BTreeCore<StringKeyTraits>;
+template class BTreeCore<VarcharKeyTraits>;
+template class BTreeCore<CompositeKeyTraits>;
+
+// the bulk loader of the posting lists, see posting.cpp
+template void BTreeCore<IntKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                    ExternalSorter<RIDKeyPair<int> > &);
+template void BTreeCore<IntKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<int> > &, const double);
+template void BTreeCore<BigintKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                       ExternalSorter<RIDKeyPair<std::int64_t> > &);
+template void BTreeCore<BigintKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<std::int64_t> > &, const double);
+template void BTreeCore<UnsignedKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                         ExternalSorter<RIDKeyPair<std::uint32_t> > &);
+template void BTreeCore<UnsignedKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<std::uint32_t> > &, const double);
+template void BTreeCore<UbigintKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                        ExternalSorter<RIDKeyPair<std::uint64_t> > &);
+template void BTreeCore<UbigintKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<std::uint64_t> > &, const double);
+template void BTreeCore<StringKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                       ExternalSorter<RIDKeyPair<StringKey> > &);
+template void BTreeCore<StringKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<StringKey> > &, const double);
+template void BTreeCore<VarcharKeyTraits>::sortRelation(const std::string &, const IndexBuildOptions &,
+                                                        ExternalSorter<RIDKeyPair<VarcharKey> > &);
+template void BTreeCore<VarcharKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPayload<VarcharKey> > &, const double);
+
+// the bulk loader of the directory of packed leaves, see packed.cpp
+template void BTreeCore<IntKeyTraits>::bulkLoad(ExternalSorter<RIDKeyPair<int> > &, const double);
+
+}
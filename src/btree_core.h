@@ -0,0 +1,623 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include "string.h"
+#include "types.h"
+#include "page.h"
+#include "btree.h"
+#include "extsort.h"
+#include "keysearch.h"
+
+namespace badgerdb
+{
+
+/*
+The tree code is written once as BTreeCore<Traits> and instantiated for every key type. A traits class names
+the key type and the node structures of that type and provides the key operations the tree needs. BTreeIndex
+creates the instantiation matching its attribute type when the index is opened and forwards every call to it,
+so the type is dispatched once per call instead of at every node and every comparison.
+*/
+
+/**
+ * @brief Key traits for the numeric keys INTEGER, BIGINT, UNSIGNED, UBIGINT and DOUBLE. Nodes are searched
+ * with the vector compares of keysearch.h.
+ */
+template <class K, class Leaf, class NonLeaf, int LEAFSLOTS, int NONLEAFSLOTS>
+struct NumericKeyTraits{
+	typedef K KeyType;
+	typedef Leaf LeafNode;
+	typedef NonLeaf NonLeafNode;
+
+	static const int LEAFSIZE = LEAFSLOTS;
+	static const int NONLEAFSIZE = NONLEAFSLOTS;
+
+  /**
+   * Copy a key given by the caller, or found in a record, into a KeyType.
+   */
+	static void load(const void* src, KeyType & key) { memcpy(&key, src, sizeof(KeyType)); }
+
+	static int lowerBound(const KeyType* keys, const int n, const KeyType & key) { return badgerdb::lowerBound(keys, n, key); }
+	static int upperBound(const KeyType* keys, const int n, const KeyType & key) { return badgerdb::upperBound(keys, n, key); }
+
+  /**
+   * Separator to put into the parent between two neighbouring leaves, given the last key of the left leaf and
+   * the first key of the right leaf. Must be greater than left, or equal to it if left equals right, and must
+   * not be greater than right.
+   */
+	static KeyType separator(const KeyType & /*left*/, const KeyType & right) { return right; }
+};
+
+typedef NumericKeyTraits<int, LeafNodeInt, NonLeafNodeInt,
+                         INTARRAYLEAFSIZE, INTARRAYNONLEAFSIZE> IntKeyTraits;
+typedef NumericKeyTraits<std::int64_t, LeafNodeBigint, NonLeafNodeBigint,
+                         BIGINTARRAYLEAFSIZE, BIGINTARRAYNONLEAFSIZE> BigintKeyTraits;
+typedef NumericKeyTraits<std::uint32_t, LeafNodeUnsigned, NonLeafNodeUnsigned,
+                         UNSIGNEDARRAYLEAFSIZE, UNSIGNEDARRAYNONLEAFSIZE> UnsignedKeyTraits;
+typedef NumericKeyTraits<std::uint64_t, LeafNodeUbigint, NonLeafNodeUbigint,
+                         UBIGINTARRAYLEAFSIZE, UBIGINTARRAYNONLEAFSIZE> UbigintKeyTraits;
+typedef NumericKeyTraits<double, LeafNodeDouble, NonLeafNodeDouble,
+                         DOUBLEARRAYLEAFSIZE, DOUBLEARRAYNONLEAFSIZE> DoubleKeyTraits;
+
+/**
+ * @brief Key traits for the character keys STRING and VARCHAR. The char[SIZE] key arrays of the nodes are accessed
+ * as CharKey<SIZE> arrays.
+ */
+template <int SIZE, class Leaf, class NonLeaf, int LEAFSLOTS, int NONLEAFSLOTS>
+struct CharKeyTraits{
+	typedef CharKey<SIZE> KeyType;
+	typedef Leaf LeafNode;
+	typedef NonLeaf NonLeafNode;
+
+	static const int LEAFSIZE = LEAFSLOTS;
+	static const int NONLEAFSIZE = NONLEAFSLOTS;
+
+	static void load(const void* src, KeyType & key) { strncpy(key.data, (const char*)src, SIZE); }
+
+	static int lowerBound(const KeyType* keys, int n, const KeyType & key)
+	{
+		int first = 0;
+		while(n > 0) {
+			const int half = n / 2;
+			if(keys[first + half] < key) {
+				first += half + 1;
+				n -= half + 1;
+			} else {
+				n = half;
+			}
+		}
+		return first;
+	}
+
+	static int upperBound(const KeyType* keys, int n, const KeyType & key)
+	{
+		int first = 0;
+		while(n > 0) {
+			const int half = n / 2;
+			if(!(key < keys[first + half])) {
+				first += half + 1;
+				n -= half + 1;
+			} else {
+				n = half;
+			}
+		}
+		return first;
+	}
+
+  /**
+   * Shortest prefix of right that is greater than left, padded with zero bytes like every key. The key slots
+   * of a node have a fixed width, so the shorter separator takes as much room and compares as fast as right
+   * would, the truncation is cosmetic.
+   */
+	static KeyType separator(const KeyType & left, const KeyType & right)
+	{
+		int len = 0;
+		while(len < SIZE && left.data[len] == right.data[len]) len ++;
+		if(len == SIZE) return right;
+		KeyType sep;
+		memset(sep.data, 0, SIZE);
+		memcpy(sep.data, right.data, len + 1);
+		return sep;
+	}
+};
+
+typedef CharKeyTraits<STRINGSIZE, LeafNodeString, NonLeafNodeString,
+                      STRINGARRAYLEAFSIZE, STRINGARRAYNONLEAFSIZE> StringKeyTraits;
+typedef CharKeyTraits<VARCHARSIZE, LeafNodeVarchar, NonLeafNodeVarchar,
+                      VARCHARARRAYLEAFSIZE, VARCHARARRAYNONLEAFSIZE> VarcharKeyTraits;
+
+/**
+ * @brief Key traits for COMPOSITE keys. The encoded columns compare with memcmp like character keys, but may hold
+ * null bytes, so keys are copied whole.
+ */
+struct CompositeKeyTraits : public CharKeyTraits<COMPOSITESIZE, LeafNodeComposite, NonLeafNodeComposite,
+                                                 COMPOSITEARRAYLEAFSIZE, COMPOSITEARRAYNONLEAFSIZE> {
+	static void load(const void* src, KeyType & key) { memcpy(key.data, src, COMPOSITESIZE); }
+};
+
+/**
+ * @brief Key type independent interface of BTreeCore, used by BTreeIndex and IndexCursor to forward their calls.
+ * The methods have the semantics of the BTreeIndex methods of the same name, except that the scan methods work on
+ * the given cursor and return false instead of throwing NoSuchKeyFoundException / IndexScanCompletedException.
+ */
+class BTreeCoreBase {
+
+ public:
+
+	virtual ~BTreeCoreBase() {}
+
+	virtual void buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions) = 0;
+
+	virtual void insertEntry(const void* key, const RecordId rid, const void* payload) = 0;
+
+	virtual bool deleteEntry(const void* key, const RecordId rid) = 0;
+
+	virtual void deleteRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp) = 0;
+
+	virtual bool startScan(IndexCursor & cursor, const void* lowVal, const Operator lowOp,
+	                       const void* highVal, const Operator highOp, const bool reverse) = 0;
+
+	virtual bool scanNext(IndexCursor & cursor, RecordId& outRid, void* outPayload) = 0;
+
+	virtual std::size_t scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids,
+	                                  void* outPayloads) = 0;
+
+	virtual std::size_t lookup(const void* key, std::vector<RecordId> & outRids) = 0;
+
+	virtual std::size_t lookupBatch(const void* keys, const std::size_t n,
+	                                std::vector<std::vector<RecordId> > & results) = 0;
+};
+
+/**
+ * @brief B+ tree operations for one key type. Works on the file, buffer manager and root of the BTreeIndex it
+ * belongs to and on the scan state of the cursors passed in.
+ */
+template <class Traits>
+class BTreeCore : public BTreeCoreBase {
+
+ public:
+
+	typedef typename Traits::KeyType KeyType;
+	typedef typename Traits::LeafNode LeafNode;
+	typedef typename Traits::NonLeafNode NonLeafNode;
+
+  /**
+   * Constructor of BTreeCore class. Sets the node occupancies of the index.
+   * @param index	Index the tree belongs to
+   */
+	BTreeCore(BTreeIndex* index);
+
+  /**
+   * Scan the base relation, collect a <key, rid> pair for every tuple, with the payload of the tuple if the index
+   * has payload columns, sort the pairs within the memory budget of buildOptions and bulk load them.
+   * @param relationName	Name of the base relation
+   * @param buildOptions	Options for the bulk loader
+   */
+	void buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions);
+
+	void insertEntry(const void* key, const RecordId rid, const void* payload);
+
+	bool deleteEntry(const void* key, const RecordId rid);
+
+	void deleteRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+	bool startScan(IndexCursor & cursor, const void* lowVal, const Operator lowOp,
+	               const void* highVal, const Operator highOp, const bool reverse);
+
+	bool scanNext(IndexCursor & cursor, RecordId& outRid, void* outPayload);
+
+	std::size_t scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids, void* outPayloads);
+
+	std::size_t lookup(const void* key, std::vector<RecordId> & outRids);
+
+	std::size_t lookupBatch(const void* keys, const std::size_t n, std::vector<std::vector<RecordId> > & results);
+
+ protected:
+
+  /**
+   * A probe key of lookupBatch and its position in the key array of the caller.
+   */
+	struct Probe {
+		KeyType key;
+		std::size_t pos;
+	};
+
+  /**
+   * Resolve sorted probe keys in the subtree rooted at nodeId. The node is read once, the probe keys are split
+   * into runs by the child they go to and every run is resolved by one call on that child.
+   * @param nodeId				Root of the subtree
+   * @param version				Version of the latch of nodeId taken before the node was reached
+   * @param treeVersion	Version of the tree latch taken before the descent
+   * @param isLeaf				True if nodeId is a leaf
+   * @param probes				Probe keys sorted by key
+   * @param n							Number of probe keys
+   * @param results				Record ids of the entries equal to a probe key are added at its position
+   * @return	False if a node changed on the way, the results are incomplete then
+   */
+	bool lookupBatchRecursive(const PageId nodeId, const std::uint64_t version, const std::uint64_t treeVersion,
+	                          const bool isLeaf, const Probe* probes, const std::size_t n,
+	                          std::vector<std::vector<RecordId> > & results);
+
+  /**
+   * Add the record ids of all entries equal to key, starting at a pinned leaf and following right siblings
+   * while the equal keys run on. The siblings are unpinned again, the given leaf stays pinned.
+   * @return	False if one of the leaves changed while it was read, nothing is added then
+   */
+	bool collectEqual(LeafNode* leaf, const PageId leafId, const std::uint64_t version, const std::uint64_t treeVersion,
+	                  const KeyType & key, std::vector<RecordId> & outRids);
+
+  /**
+   * A non-leaf node on the way from the root to a leaf, the position of the child taken, the version of the latch
+   * of the node when it was read, 0 on descents under the tree latch, and its number of keys.
+   */
+	struct PathStep {
+		PageId pageNo;
+		int child;
+		std::uint64_t version;
+		int keyCount;
+	};
+
+  /**
+   * Descend from the root to the leaf where the entries for key start.
+   * @param key		Key to look for
+   * @param lower	True to find the leftmost leaf that may hold key, needed when all entries equal to key
+   *							are wanted, false to find the leaf holding the first key greater than key
+   * @param path	If given, the non-leaf nodes passed are appended to it, root first
+   * @return	Page number of the leaf, not pinned
+   */
+	PageId findLeaf(const KeyType & key, const bool lower, std::vector<PathStep>* path = NULL);
+
+  /**
+   * findLeaf() without latching, for callers that may run next to writers. Every node is validated after it is
+   * read and before its child is used, the latch of the child is read before the parent is validated again.
+   * @param treeVersion	Version of the tree latch taken by the caller
+   * @param leafId				Set to the page number of the leaf, 0 if the tree is empty
+   * @param leafVersion		Set to the version of the latch of the leaf, the leaf itself is not read
+   * @return	False if a node changed on the way, the caller starts over
+   */
+	bool findLeafOptimistic(const KeyType & key, const bool lower, const std::uint64_t treeVersion, PageId & leafId,
+	                        std::uint64_t & leafVersion, std::vector<PathStep>* path = NULL);
+
+  /**
+   * True if the latch of the node on page pageNo is still at version and the tree latch at treeVersion.
+   */
+	bool validate(const PageId pageNo, const std::uint64_t version, const std::uint64_t treeVersion)
+	{
+		return index->latches.node(pageNo).validate(version) && index->latches.tree().validate(treeVersion);
+	}
+
+  /**
+   * Number of keys of a node read without its latch. A writer may change it at any time, so it is kept within
+   * the slots of the node and the reader finds out when it validates.
+   */
+	int lengthOf(LeafNode* leaf) const { return std::min(std::max(leaf->keyArrLength, 0), index->leafOccupancy); }
+	int lengthOf(NonLeafNode* node) const { return std::min(std::max(node->keyArrLength, 0), index->nodeOccupancy); }
+
+  /**
+   * Insert <key, rid> into a full leaf found by an optimistic descent, splitting it and the full nodes above it up
+   * to path[top], which takes the new separator. Those nodes, the leaf and its right sibling are latched top-down,
+   * failing at once if any of them changed since it was read.
+   * @param path		Path of the descent to the leaf
+   * @param top			Position in path of the lowest node with a free slot
+   * @return	False if a latch could not be taken, nothing is changed then
+   */
+	bool insertSplitting(const std::vector<PathStep> & path, const int top, const PageId leafId,
+	                     const std::uint64_t leafVersion, const std::uint64_t treeVersion,
+	                     const KeyType & key, const RecordId rid, const void* payload);
+
+  /**
+   * insertEntry() without the tree latch, into the leaf if it has a free slot, else by insertSplitting().
+   * @param unique		True if the tree holds every key at most once, like the directory of an index with posting lists
+   * @param present	Set to true if unique is set and key is in the tree already, nothing is inserted then
+   * @return	False if the tree is empty or the root has to split, nothing is inserted then and the caller takes
+   *					the tree latch
+   */
+	bool insertOptimistic(const KeyType & key, const RecordId rid, const void* payload, const bool unique,
+	                      bool & present);
+
+  /**
+   * Remove the entry at pos from a leaf. The caller holds the latch of the leaf or the tree latch.
+   */
+	void removeFromLeaf(LeafNode* leaf, const int pos);
+
+  /**
+   * insertEntry() and deleteEntry() for the cases that change the root or merge nodes, run holding the tree latch.
+   */
+	void insertExclusive(const KeyType & key, const RecordId rid, const void* payload);
+	bool deleteExclusive(const KeyType & key, const RecordId rid);
+
+  /**
+   * deleteRange() once the operators and the range are checked, run holding the tree latch.
+   */
+	virtual void deleteRangeExclusive(const KeyType & lowKey, const Operator lowOp, const KeyType & highKey,
+	                                  const Operator highOp);
+
+  /**
+   * Position a cursor at the first entry past key, or not below key if after is false; at the last entry before
+   * key in a reverse scan. The leaf is pinned and the versions of its latch and of the tree latch are kept.
+   * @return	False if the tree is empty, no leaf is pinned then
+   */
+	bool seek(IndexCursor & cursor, const KeyType & key, const bool after);
+
+  /**
+   * True if the current leaf of a cursor has not changed since the cursor got to it.
+   */
+	bool cursorValid(IndexCursor & cursor) { return validate(cursor.currentPageNum, cursor.leafVersion, cursor.treeVersion); }
+
+  /**
+   * Find the place of a cursor again after its leaf changed, from the last key it returned.
+   */
+	void reposition(IndexCursor & cursor);
+
+  /**
+   * Skip an entry with the last key returned if the cursor still has such entries to skip after reposition().
+   * @return	True if the entry with key is skipped
+   */
+	bool skipEqual(IndexCursor & cursor, const KeyType & key);
+
+  /**
+   * Remember that count entries were returned, the last of them with key.
+   */
+	void noteReturned(IndexCursor & cursor, const KeyType & key, const int count);
+
+  /**
+   * Move a cursor to the right sibling of its current leaf. If the current leaf changed meanwhile the cursor
+   * finds its place again instead.
+   * @return	False if the current leaf is the last one
+   */
+	bool moveToRightSibling(IndexCursor & cursor);
+
+  /**
+   * Move a cursor to the left sibling of its current leaf, at the last entry. If the current leaf changed
+   * meanwhile the cursor finds its place again instead.
+   * @return	False if the current leaf is the first one
+   */
+	bool moveToLeftSibling(IndexCursor & cursor);
+
+  /**
+   * Called when a cursor moves to another leaf. Once the leaves of the last read-ahead are half used up, the
+   * operating system is told to read the next leaves of the scan, taken from the parent of the current leaf.
+   * The window doubles each time, so short scans cost no extra reads and long ones keep the disk busy ahead.
+   */
+	void readAhead(IndexCursor & cursor);
+
+  /**
+   * scanNext() and scanNextBatch() of a reverse scan.
+   */
+	bool scanPrev(IndexCursor & cursor, RecordId& outRid, void* outPayload);
+	std::size_t scanPrevBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids, void* outPayloads);
+
+  /**
+   * Set the left sibling of a leaf, does nothing if leafId is 0.
+   */
+	void setLeftSibling(const PageId leafId, const PageId leftId);
+
+  /**
+   * High value of the scan of a cursor.
+   */
+	static const KeyType & highValOf(const IndexCursor & cursor) { return *(const KeyType*)cursor.highVal; }
+
+  /**
+   * Low value of the scan of a cursor.
+   */
+	static const KeyType & lowValOf(const IndexCursor & cursor) { return *(const KeyType*)cursor.lowVal; }
+
+  /**
+   * Last key returned by a cursor.
+   */
+	static const KeyType & lastKeyOf(const IndexCursor & cursor) { return *(const KeyType*)cursor.lastKey; }
+
+  /**
+   * Key array of a node, as an array of KeyType.
+   */
+	static KeyType* keysOf(LeafNode* node) { return (KeyType*)node->keyArray; }
+	static KeyType* keysOf(NonLeafNode* node) { return (KeyType*)node->keyArray; }
+
+  /**
+   * Key of a record of the base relation, the attribute at attrByteOffset or the encoded columns of a COMPOSITE key.
+   */
+	void loadRecordKey(const char* record, KeyType & key) const;
+
+  /**
+   * Key and, for a RIDKeyPayload, payload of a record of the base relation, as sorted by the bulk loader.
+   */
+	void loadRecordEntry(const char* record, RIDKeyPair<KeyType> & entry) const { loadRecordKey(record, entry.key); }
+	void loadRecordEntry(const char* record, RIDKeyPayload<KeyType> & entry) const;
+
+  /**
+   * Payload of an entry of the bulk loader, NULL for a RIDKeyPair.
+   */
+	static const void* payloadOf(const RIDKeyPair<KeyType> & /*entry*/) { return NULL; }
+	static const void* payloadOf(const RIDKeyPayload<KeyType> & entry) { return entry.payload; }
+
+  /**
+   * Payloads of a leaf, payloadSize bytes per entry. Payloads make the leaf occupancy smaller than the slots of
+   * the rid array, they are kept in the unused rid slots after leafOccupancy.
+   */
+	char* payloadsOf(LeafNode* leaf) const { return (char*)&leaf->ridArray[index->leafOccupancy]; }
+
+  /**
+   * Move the payloads of n entries of leaf src from position srcPos to position dstPos of leaf dst, like memmove.
+   * Does nothing if the index has no payload.
+   */
+	void movePayloads(LeafNode* dst, const int dstPos, LeafNode* src, const int srcPos, const int n) const;
+
+  /**
+   * Set the payload of an entry, to zero if payload is NULL.
+   */
+	void setPayload(LeafNode* leaf, const int pos, const void* payload) const;
+
+  /**
+   * Sort the entries of the base relation and bulk load them, the part of buildIndex that depends on the
+   * entries carrying payloads.
+   * @param Entry	RIDKeyPair, or RIDKeyPayload if the index has payload columns
+   */
+	template <class Entry>
+	void sortAndLoad(const std::string & relationName, const IndexBuildOptions & buildOptions);
+
+  /**
+   * Scan the base relation with the threads of buildOptions, hand an entry for every record to the sorter and
+   * finish it, so that it streams the entries by key.
+   */
+	template <class Entry>
+	void sortRelation(const std::string & relationName, const IndexBuildOptions & buildOptions,
+	                  ExternalSorter<Entry> & sorter);
+
+  /**
+   * Scan the base relation with several threads. The pages of the relation are split into one contiguous
+   * range per thread. Pages are read through the buffer manager one at a time under a lock, the records are
+   * parsed and the extracted entries are sorted by the thread and handed to the sorter as runs.
+   * The runs being built and the runs buffered by the sorter each take at most half of the sort memory.
+   * @param relationName	Name of the base relation
+   * @param sorter				Sorter receiving the sorted runs
+   * @param numThreads		Number of threads
+   */
+	template <class Entry>
+	void scanRelationParallel(const std::string & relationName, ExternalSorter<Entry> & sorter, const int numThreads);
+
+  /**
+   * Build the tree bottom-up from sorted <key, rid> pairs. Leaves are written left to right, filled up to
+   * fillFactor and linked through rightSibPageNo, then every non-leaf level is built on top of the level below
+   * until a single root remains. Sets rootPageNum.
+   * @param entries			Sorter streaming the entries by key, finish() has been called. Payloads come with them.
+   * @param fillFactor	Fraction of the slots of each page to fill
+   */
+	template <class Entry>
+	void bulkLoad(ExternalSorter<Entry> & entries, const double fillFactor);
+
+  /**
+   * Page number of the child of a non-leaf node to follow for key.
+   */
+	static PageId findChild(NonLeafNode* node, const KeyType & key);
+
+  /**
+   * Insert <key, rid> and its payload into a leaf that has a free slot, after any equal keys.
+   */
+	void insertToLeaf(LeafNode* leaf, const KeyType & key, const RecordId rid, const void* payload);
+
+  /**
+   * Insert a separator key and the page to its right into a non-leaf node that has a free slot.
+   */
+	static void insertToNonLeaf(NonLeafNode* node, const KeyType & key, const PageId rightPage);
+
+  /**
+   * Split a full leaf while inserting <key, rid>. The upper half of the entries moves to a new right sibling.
+   * @return	Page number of the new leaf and the separator key to insert into the parent
+   */
+	PageKeyPair<KeyType> splitLeaf(LeafNode* node, const PageId nodeId, const KeyType & key, const RecordId rid,
+	                               const void* payload);
+
+  /**
+   * Split a full non-leaf node while inserting a separator key and the page to its right.
+   * The middle key moves up to the parent.
+   * @return	Page number of the new node and the separator key to insert into the parent
+   */
+	PageKeyPair<KeyType> splitNonLeaf(NonLeafNode* node, const KeyType & key, const PageId rightPage);
+
+  /**
+   * Insert <key, rid> and its payload into the subtree rooted at nodeId.
+   * @param nodeId		Root of the subtree
+   * @param lastLevel	Level of the parent node, 1 if nodeId is a leaf
+   * @param split			Set to the new page and its separator key if nodeId was split
+   * @return	True if nodeId was split
+   */
+	bool insertRecursive(const PageId nodeId, const KeyType & key, const RecordId rid, const void* payload,
+	                     const int lastLevel, PageKeyPair<KeyType> & split);
+
+  /**
+   * Remove <key, rid> from the subtree rooted at nodeId.
+   * @param nodeId		Root of the subtree
+   * @param lastLevel	Level of the parent node, 1 if nodeId is a leaf
+   * @param underflow	Set to true if nodeId is less than half full afterwards
+   * @return	False if the entry is not in the subtree
+   */
+	bool deleteRecursive(const PageId nodeId, const KeyType & key, const RecordId rid, const int lastLevel,
+	                     bool & underflow);
+
+  /**
+   * Balance an underflowing child of a non-leaf node with a sibling, by moving entries over or by merging.
+   * @param node	Pinned parent node, updated in place
+   * @param child	Position of the underflowing child in node
+   * @return	False if the child has no sibling to balance with
+   */
+	bool rebalance(NonLeafNode* node, const int child);
+
+  /**
+   * Spread the entries of two neighbouring leaves evenly, or merge the right one into the left one if both
+   * fit into one leaf with a slot to spare.
+   * @param separator	Key between the two leaves in their parent, replaced if entries move
+   * @return	True if the leaves were merged
+   */
+	bool balanceLeaves(LeafNode* leftNode, LeafNode* rightNode, KeyType & separator);
+
+  /**
+   * Spread the keys of two neighbouring non-leaf nodes evenly, or merge them with their separator.
+   * @param separator	Key between the two nodes in their parent, replaced if keys move
+   * @return	True if the nodes were merged
+   */
+	bool balanceNonLeaves(NonLeafNode* leftNode, NonLeafNode* rightNode, KeyType & separator);
+
+  /**
+   * Make the only child of the root the new root for as long as the root has no keys and is not right above
+   * the leaves.
+   */
+	void shrinkRoot();
+
+  /**
+   * Rebalance a child of a non-leaf node if it is less than half full.
+   * @param nodeId	Parent node, not pinned
+   * @param child		Position of the child in the parent
+   * @return	True if the child was balanced with a sibling
+   */
+	bool fixUnderflow(const PageId nodeId, const int child);
+
+  /**
+   * Rebalance the leaves on both sides of the gap a range delete left and the nodes above them, until none of
+   * them is less than half full.
+   * @param key		Low key of the deleted range
+   * @param lower	True if the low key itself was deleted
+   */
+	void rebalanceGap(const KeyType & key, const bool lower);
+
+  /**
+   * Turn the path to a leaf into the path to its left or right sibling.
+   * @param path	Path as findLeaf gives it, changed in place
+   * @param right	True for the right sibling
+   * @return	False if the leaf has no sibling on that side
+   */
+	bool siblingPath(std::vector<PathStep> & path, const bool right);
+
+  /**
+   * Put every page of the subtree rooted at nodeId on the free list. Leaves are not read for their entries.
+   */
+	void freeSubtree(const PageId nodeId, const bool isLeaf);
+
+  /**
+   * Allocate a page for a new node, taking it from the free list if there is one. The page is pinned.
+   */
+	void allocNode(PageId & pageNo, Page* & page);
+
+  /**
+   * Put the page of a node that has been removed from the tree on the free list. The page must not be pinned.
+   */
+	void freeNode(const PageId pageNo);
+
+  /**
+   * Set the head of the free list, in the index and on the meta page.
+   */
+	void setFreePageNum(const PageId pageNo);
+
+  /**
+   * Index the tree belongs to.
+   */
+	BTreeIndex* index;
+};
+
+}
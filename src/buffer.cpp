@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <iostream>
+#include <thread>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
@@ -33,7 +34,11 @@ BufMgr::BufMgr(std::uint32_t bufs)
   bufPool = new Page[bufs];
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  for (int i = 0; i < PARTITIONS; i++)
+  {
+  	// allocate the buffer hash table, a part of it per partition
+  	partitions[i].hashTable = new BufHashTbl (htsize / PARTITIONS + 1);
+  }
 
   clockHand = bufs - 1;
 }
@@ -50,15 +55,27 @@ BufMgr::~BufMgr() {
   	}
   }
 
+  for (int i = 0; i < PARTITIONS; i++)
+  {
+  	delete partitions[i].hashTable;
+  }
   delete [] bufDescTable;
   delete [] bufPool;
 }
 
+void BufMgr::lockPartitions(std::unique_lock<std::mutex> * locks)
+{
+  for (int i = 0; i < PARTITIONS; i++)
+  {
+  	locks[i] = std::unique_lock<std::mutex>(partitions[i].mutex);
+  }
+}
+
 void BufMgr::allocBuf(FrameId & frame) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
-  // Assumes non-concurrent access to buffer manager
+  std::lock_guard<std::mutex> clockLock(clockMutex);
   std::uint32_t numScanned = 0;
   bool found = 0;
 
@@ -67,50 +84,64 @@ void BufMgr::allocBuf(FrameId & frame)
     // advance the clock
     advanceClock();
     numScanned++;
+    BufDesc* tmpbuf = &bufDescTable[clockHand];
+
+    // pinned, or being set up by the thread that allocated it. A frame nobody has pinned is only changed by
+    // threads holding the clock lock, and pinned only through the hash table
+    if (tmpbuf->pinCnt > 0)
+    {
+      continue;
+    }
 
     // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
+    if (! tmpbuf->valid)
     {
+      tmpbuf->pinCnt = 1;
+      found = true;
       break;
     }
 
     // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
-    {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
-      {
-        // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        found = true;
-        break;
-      }
-    }
-    else
+    if (tmpbuf->refbit)
     {
       // has been referenced, clear the bit
       bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
+      tmpbuf->refbit = false;
+      continue;
+    }
+
+    // hasn't been referenced, check again that nobody has pinned it, holding the lock of its partition
+    BufPartition & part = partitionOf(tmpbuf->file, tmpbuf->pageNo);
+    std::lock_guard<std::mutex> lock(part.mutex);
+    if (tmpbuf->pinCnt > 0)
+    {
+      continue;
+    }
+
+    // flush any existing changes to disk if necessary, before the page leaves the hash table, so that a thread
+    // reading it in again reads the changes
+    if (tmpbuf->dirty)
+    {
+      bufStats.diskwrites++;
+      std::lock_guard<std::mutex> fileLock(fileMutex);
+      tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[clockHand]);
     }
+
+    // remove previous entry from hash table
+    part.hashTable->remove(tmpbuf->file, tmpbuf->pageNo);
+
+    //Reset all the BufDesc entry for the frame before returning the frame
+    tmpbuf->Clear();
+    tmpbuf->pinCnt = 1;
+    found = true;
+    break;
   }
   
   // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
+  if (!found)
   {
     throw BufferExceededException();
   }
-  
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
-  {
-    bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
-  }
-
-	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
 
   // return new frame number
   frame = clockHand;
@@ -119,34 +150,89 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
-  // check to see if it is already in the buffer pool
-  // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
+  BufPartition & part = partitionOf(file, pageNo);
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
-
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
-  }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+  while (true)
   {
-    // alloc a new frame
+    // check to see if it is already in the buffer pool
+    // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
+    bool hit = true;
+    {
+      std::lock_guard<std::mutex> lock(part.mutex);
+      try
+      {
+        part.hashTable->lookup(file, pageNo, frameNo);
+
+        // set the referenced bit
+        bufDescTable[frameNo].refbit = true;
+        bufDescTable[frameNo].pinCnt++;
+      }
+      catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+      {
+        hit = false;
+      }
+    }
+
+    if (hit)
+    {
+      // wait for the thread reading the page in, start over if reading it failed
+      BufDesc* tmpbuf = &bufDescTable[frameNo];
+      while (tmpbuf->loading)
+      {
+        std::this_thread::yield();
+      }
+      if (tmpbuf->valid)
+      {
+        page = &bufPool[frameNo];
+        return;
+      }
+      tmpbuf->pinCnt--;
+      continue;
+    }
+
+    // alloc a new frame, then check that no other thread has read the page in meanwhile
     allocBuf(frameNo);
+    BufDesc* tmpbuf = &bufDescTable[frameNo];
+    {
+      std::lock_guard<std::mutex> lock(part.mutex);
+      FrameId otherFrame = 0;
+      try
+      {
+        part.hashTable->lookup(file, pageNo, otherFrame);
+        tmpbuf->pinCnt = 0;
+        continue;
+      }
+      catch(HashNotFoundException e)
+      {
+      }
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+      // set up the entry properly and insert it in the hash table, other threads wait for the read
+      tmpbuf->Set(file, pageNo);
+      tmpbuf->loading = true;
+      part.hashTable->insert(file, pageNo, frameNo);
+    }
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
+    // read the page into the new frame
+    try
+    {
+      bufStats.diskreads++;
+      std::lock_guard<std::mutex> fileLock(fileMutex);
+      //status = file->readPage(pageNo, &bufPool[frameNo]);
+      bufPool[frameNo] = file->readPage(pageNo);
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(part.mutex);
+      part.hashTable->remove(file, pageNo);
+      tmpbuf->valid = false;
+      tmpbuf->file = NULL;
+      tmpbuf->loading = false;
+      tmpbuf->pinCnt--;
+      throw;
+    }
+    tmpbuf->loading = false;
     page = &bufPool[frameNo];
-
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+    return;
   }
 }
 
@@ -154,9 +240,11 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 void BufMgr::unPinPage(File* file, const PageId pageNo, 
 			     const bool dirty) 
 {
+  BufPartition & part = partitionOf(file, pageNo);
+  std::lock_guard<std::mutex> lock(part.mutex);
   // lookup in hashtable
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  part.hashTable->lookup(file, pageNo, frameNo);
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
@@ -170,6 +258,9 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::lock_guard<std::mutex> clockLock(clockMutex);
+  std::unique_lock<std::mutex> locks[PARTITIONS];
+  lockPartitions(locks);
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -181,11 +272,12 @@ void BufMgr::flushFile(const File* file)
 	    if (tmpbuf->dirty == true)
 			{
 				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
+				std::lock_guard<std::mutex> fileLock(fileMutex);
 				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
 				tmpbuf->dirty = false;
     	}
 
-    	hashTable->remove(file,tmpbuf->pageNo);
+    	partitionOf(file, tmpbuf->pageNo).hashTable->remove(file,tmpbuf->pageNo);
     	tmpbuf->Clear();
   	}
 		else if (tmpbuf->valid == false && tmpbuf->file == file)
@@ -195,12 +287,16 @@ void BufMgr::flushFile(const File* file)
 
 void BufMgr::cleanUpPinnedPage(File* file) 
 {
+  std::lock_guard<std::mutex> clockLock(clockMutex);
+  std::unique_lock<std::mutex> locks[PARTITIONS];
+  lockPartitions(locks);
   for (std::uint32_t i = 0; i < numBufs; i++) {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if(tmpbuf->valid == true && tmpbuf->file == file) {
 	    if (tmpbuf->pinCnt > 0) {
-        tmpbuf->pinCnt = 1;
-        this->unPinPage(file, tmpbuf->pageNo, true);
+        // unpin it completely and keep the changes
+        tmpbuf->pinCnt = 0;
+        tmpbuf->dirty = true;
       }
     }
   }
@@ -208,40 +304,56 @@ void BufMgr::cleanUpPinnedPage(File* file)
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  std::lock_guard<std::mutex> clockLock(clockMutex);
+  BufPartition & part = partitionOf(file, pageNo);
+  std::lock_guard<std::mutex> lock(part.mutex);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  part.hashTable->lookup(file, pageNo, frameNo);
 
 	// clear the page
 	bufDescTable[frameNo].Clear();
 
-	hashTable->remove(file, pageNo);
+	part.hashTable->remove(file, pageNo);
 
   // deallocate it in the file	
+  std::lock_guard<std::mutex> fileLock(fileMutex);
   file->deletePage(pageNo);
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
-  
   FrameId frameNo;
   // alloc a new frame
   allocBuf(frameNo);
   
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  try
+  {
+    std::lock_guard<std::mutex> fileLock(fileMutex);
+    bufPool[frameNo] = file->allocatePage(pageNo);
+  }
+  catch(...)
+  {
+    bufDescTable[frameNo].pinCnt = 0;
+    throw;
+  }
   page = &bufPool[frameNo];
-  // set up the entry properly
-  bufDescTable[frameNo].Set(file, pageNo);
 
-  // insert in the hash table
-  hashTable->insert(file, pageNo, frameNo);
+  // set up the entry properly and insert it in the hash table
+  BufPartition & part = partitionOf(file, pageNo);
+  std::lock_guard<std::mutex> lock(part.mutex);
+  bufDescTable[frameNo].Set(file, pageNo);
+  part.hashTable->insert(file, pageNo, frameNo);
 }
 
 void BufMgr::printSelf(void) 
 {
+  std::lock_guard<std::mutex> clockLock(clockMutex);
+  std::unique_lock<std::mutex> locks[PARTITIONS];
+  lockPartitions(locks);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
@@ -10,6 +10,9 @@
 #include "file.h"
 #include "bufHashTbl.h"
 #include <iostream>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 
 namespace badgerdb {
 
@@ -42,9 +45,10 @@ class BufDesc {
   FrameId	frameNo;
 
 	/**
-   * Number of times this page has been pinned
+   * Number of times this page has been pinned. Pages are pinned holding the lock of their partition, so a frame
+   * seen unpinned under that lock stays unpinned until it is released
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
@@ -59,7 +63,13 @@ class BufDesc {
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
+
+	/**
+   * True while the page is read from the file into the frame. The frame is in the hash table already, threads
+   * pinning it wait until the read is done
+	 */
+  std::atomic<bool> loading;
 
 	/**
    * Initialize buffer frame for a new user
@@ -72,6 +82,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+		loading = false;
   };
 
 	/**
@@ -89,6 +100,7 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    loading = false;
   }
 
   void Print()
@@ -125,17 +137,17 @@ struct BufStats
 	/**
    * Total number of accesses to buffer pool
 	 */
-  int accesses;
+  std::atomic<int> accesses;
 
 	/**
    * Number of pages read from disk (including allocs)
 	 */
-  int diskreads;
+  std::atomic<int> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<int> diskwrites;
 
 	/**
    * Clear all values 
@@ -155,12 +167,39 @@ struct BufStats
 };
 
 
+/**
+* @brief Part of the hash table of the buffer pool, with the lock for the pages it maps.
+*/
+struct BufPartition
+{
+	/**
+   * Held while the hash table of the partition is used and while pages of the partition are pinned and unpinned
+	 */
+  std::mutex mutex;
+
+	/**
+   * Hash table mapping the (File, page) pairs of the partition to frames
+	 */
+  BufHashTbl *hashTable;
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* The public methods can be called from several threads. Pages are spread over a fixed number of partitions of the
+* hash table by page number, and a page found in the pool is pinned and unpinned holding only the lock of its
+* partition, so threads reading different pages do not wait for each other. Only allocating a frame takes the
+* clock lock, and reading or writing a file the file lock, which serializes the streams files share. Pinned pages
+* stay in their frame, what threads do with the data of a page they share is up to them.
 */
 class BufMgr 
 {
  private:
+	/**
+   * Number of partitions of the hash table
+	 */
+  static const int PARTITIONS = 16;
+
 	/**
    * Current position of clockhand in our buffer pool
 	 */
@@ -172,9 +211,9 @@ class BufMgr
   std::uint32_t numBufs;
 	
 	/**
-   * Hash table mapping (File, page) to frame
+   * Partitions of the hash table mapping (File, page) to frame
 	 */
-  BufHashTbl *hashTable;
+  BufPartition partitions[ PARTITIONS ];
 
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
@@ -187,13 +226,38 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-	 * Allocate a free frame.  
+   * Held while the clock hand moves and frames are allocated, and by the methods that go through all frames.
+   * Taken before any partition lock
+	 */
+  std::mutex clockMutex;
+
+	/**
+   * Held while a file is read or written. Taken after any other lock
+	 */
+  std::mutex fileMutex;
+
+	/**
+	 * Allocate a free frame. Called without a partition lock, the partition of the page evicted is locked.
 	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable. The frame is not
+	 *									valid and pinned once, so that no other thread allocates it
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
   void allocBuf(FrameId & frame);
 
+	/**
+   * Partition of the hash table a page belongs to
+	 */
+  BufPartition & partitionOf(const File* file, const PageId pageNo)
+  {
+		return partitions[((std::uintptr_t)file / sizeof(void*) + pageNo) % PARTITIONS];
+  }
+
+	/**
+   * Lock all partitions, in order, for the methods that go through all frames. Called holding the clock lock
+	 */
+  void lockPartitions(std::unique_lock<std::mutex> * locks);
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
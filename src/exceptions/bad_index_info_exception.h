@@ -14,28 +14,28 @@
 namespace badgerdb {
 
 /**
- * @brief An exception that is thrown when a file operation is requested for a
- *        filename that doesn't exist.
+ * @brief An exception that is thrown when the meta page of an existing index
+ *        file does not match the index being opened.
  */
 class BadIndexInfoException : public BadgerDbException {
  public:
   /**
-   * Constructs a file not found exception for the given file.
+   * Constructs a bad index info exception for the given reason.
    *
-   * @param name  Name of file that doesn't exist.
+   * @param reason  Why the index info does not match.
    */
   explicit BadIndexInfoException(const std::string& reason);
 
   /**
-   * Returns the name of the file that caused this exception.
+   * Returns the reason of this exception.
    */
   virtual const std::string& reason() const { return reason_; }
 
  protected:
   /**
-   * Name of file that caused this exception.
+   * Reason of this exception. Stored as a copy since the exception outlives the caller's string.
    */
-  const std::string& reason_;
+  const std::string reason_;
 };
 
 }
@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "key_too_long_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+KeyTooLongException::KeyTooLongException(const int maxSize)
+    : BadgerDbException("") {
+  std::stringstream ss;
+  ss << "Key is longer than " << maxSize << " bytes.";
+  message_.assign(ss.str());
+}
+
+}
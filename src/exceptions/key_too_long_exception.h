@@ -0,0 +1,30 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a key passed to an index is longer
+ *        than the keys of the index can be.
+ */
+class KeyTooLongException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a key too long exception for keys of at most the given size.
+   *
+   * @param maxSize  Largest key size the index takes, in bytes.
+   */
+  explicit KeyTooLongException(const int maxSize);
+};
+
+}
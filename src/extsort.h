@@ -0,0 +1,436 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include "string.h"
+#include "types.h"
+#include "page.h"
+#include "file.h"
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief External merge sort for fixed size entries (e.g. RIDKeyPair) that may not fit in memory.
+ * Entries are collected in a buffer of memPages pages. A full buffer is sorted and spilled as a run
+ * to pages of a temporary BlobFile through the buffer manager. finish() merges the runs with a k-way heap,
+ * in several passes if there are more runs than the memory budget allows to read at once, and next()
+ * streams the sorted result. If all entries fit in the buffer nothing is written to disk.
+ * Runs sorted by the caller, e.g. by several threads, can be added with addSortedRun().
+ * At most memPages pages of the temporary file are kept in the buffer pool, so sorting does not evict
+ * everything else from the pool. T must be copyable with memcpy and define operator<.
+ */
+template <class T>
+class ExternalSorter {
+
+ public:
+
+  /**
+   * Constructor of ExternalSorter class.
+   *
+   * @param bufMgrIn	Buffer Manager Instance used to write and read runs
+   * @param tempName	Name of the temporary file holding the runs. Created on first spill, removed by the destructor.
+   * @param memPages	Memory budget in pages. At least 3 pages are used.
+   */
+	ExternalSorter(BufMgr *bufMgrIn, const std::string & tempName, const std::uint32_t memPages)
+		: bufMgr(bufMgrIn), tempName(tempName), tempFile(NULL), poolPages(0), total(0),
+		  inMemory(false), memPos(0), runsOnly(true)
+	{
+		this->memPages = std::max<std::uint32_t>(memPages, 3);
+		this->bufferCap = this->memPages * ENTRIESPERPAGE;
+	}
+
+  /**
+   * Destructor of ExternalSorter class. Drops the pages of the temporary file from the buffer pool and removes the file.
+   */
+	~ExternalSorter()
+	{
+		if(tempFile != NULL) {
+			try {
+				bufMgr->flushFile(tempFile);
+			} catch(...) {
+			}
+			delete tempFile;
+			try {
+				File::remove(tempName);
+			} catch(FileNotFoundException& e) {
+			}
+		}
+	}
+
+  /**
+   * Add an entry. Spills a sorted run if the memory buffer is full.
+   * @param entry	Entry to add
+   */
+	void add(const T & entry)
+	{
+		buffer.push_back(entry);
+		runsOnly = false;
+		total ++;
+		if(buffer.size() >= bufferCap) {
+			spillBuffer();
+		}
+	}
+
+  /**
+   * Add a run of entries that is already sorted. The caller holds the runs it is still building in memory,
+   * so sorted runs only fill half of the memory buffer, leaving the other half of the budget to the caller.
+   * A run is kept in the buffer if it fits there and written to the temporary file as it is otherwise.
+   * @param run	Sorted entries
+   */
+	void addSortedRun(const std::vector<T> & run)
+	{
+		if(run.empty()) return;
+		total += run.size();
+		const std::size_t runBufferCap = bufferCap / 2;
+		if(buffer.size() + run.size() > runBufferCap) {
+			if(!buffer.empty()) {
+				spillBuffer();
+			}
+			if(run.size() >= runBufferCap) {
+				writeRun(&run[0], run.size());
+				return;
+			}
+		}
+		buffer.insert(buffer.end(), run.begin(), run.end());
+		runEnds.push_back(buffer.size());
+	}
+
+  /**
+   * Number of entries that fit in the memory budget.
+   */
+	std::size_t capacity() const { return bufferCap; }
+
+  /**
+   * Sort the last entries and merge runs until the remaining ones can be merged in a single pass by next().
+   */
+	void finish()
+	{
+		if(runs.empty()) {
+			sortBuffer();
+			inMemory = true;
+			memPos = 0;
+			return;
+		}
+
+		if(!buffer.empty()) {
+			spillBuffer();
+		}
+		std::vector<T>().swap(buffer);
+
+		// one page is kept for the output run of intermediate merges
+		const std::size_t fanIn = memPages - 1;
+		while(runs.size() > fanIn) {
+			openMerge(0, fanIn);
+			Run merged;
+			merged.numEntries = 0;
+			merged.firstPage = Page::INVALID_NUMBER;
+
+			// output page is filled in memory so no page is pinned while runs are read
+			Page outPage;
+			int slot = 0;
+			T entry;
+			while(popMerge(entry)) {
+				memcpy((char*)&outPage + slot * sizeof(T), &entry, sizeof(T));
+				merged.numEntries ++;
+				if(++ slot == ENTRIESPERPAGE) {
+					writeRunPage(merged, (char*)&outPage, slot);
+					slot = 0;
+				}
+			}
+			if(slot > 0) {
+				writeRunPage(merged, (char*)&outPage, slot);
+			}
+
+			runs.erase(runs.begin(), runs.begin() + fanIn);
+			runs.push_back(merged);
+		}
+		openMerge(0, runs.size());
+	}
+
+  /**
+   * Fetch the next entry in sorted order. finish() has to be called first.
+   * @param outEntry	Next entry is returned in this
+   * @return	False if all entries have been returned
+   */
+	bool next(T & outEntry)
+	{
+		if(inMemory) {
+			if(memPos == buffer.size()) return false;
+			outEntry = buffer[memPos ++];
+			return true;
+		}
+		return popMerge(outEntry);
+	}
+
+  /**
+   * Number of entries added to the sorter.
+   */
+	std::size_t size() const { return total; }
+
+ private:
+
+  /**
+   * Number of entries stored in one page of a run.
+   */
+	static const int ENTRIESPERPAGE = Page::SIZE / sizeof(T);
+
+  /**
+   * A sorted run stored in consecutive pages of the temporary file.
+   */
+	struct Run {
+		PageId firstPage;
+		std::size_t numEntries;
+	};
+
+  /**
+   * Read position in a run during a merge. Holds a copy of the current page so no page stays pinned.
+   */
+	struct RunCursor {
+		Page page;
+		PageId pageNo;
+		int slot;
+		std::size_t remaining;
+	};
+
+  /**
+   * Heap order for the k-way merge, smallest entry on top.
+   */
+	struct HeapGreater {
+		bool operator()(const std::pair<T, int> & a, const std::pair<T, int> & b) const
+		{
+			return b.first < a.first;
+		}
+	};
+
+  /**
+   * Sort the memory buffer. If it only holds sorted runs they are merged pairwise instead.
+   */
+	void sortBuffer()
+	{
+		if(!runsOnly) {
+			std::sort(buffer.begin(), buffer.end());
+		} else {
+			while(runEnds.size() > 1) {
+				std::vector<std::size_t> merged;
+				std::size_t begin = 0;
+				for(std::size_t i = 0; i + 1 < runEnds.size(); i += 2) {
+					std::inplace_merge(buffer.begin() + begin, buffer.begin() + runEnds[i], buffer.begin() + runEnds[i + 1]);
+					merged.push_back(runEnds[i + 1]);
+					begin = runEnds[i + 1];
+				}
+				if(runEnds.size() % 2 == 1) {
+					merged.push_back(runEnds.back());
+				}
+				runEnds.swap(merged);
+			}
+		}
+		runEnds.clear();
+		runsOnly = true;
+	}
+
+  /**
+   * Sort the memory buffer and write it as a new run.
+   */
+	void spillBuffer()
+	{
+		sortBuffer();
+		writeRun(&buffer[0], buffer.size());
+		buffer.clear();
+	}
+
+  /**
+   * Write sorted entries as a new run.
+   */
+	void writeRun(const T* entries, const std::size_t cnt)
+	{
+		if(tempFile == NULL) {
+			try {
+				File::remove(tempName);
+			} catch(FileNotFoundException& e) {
+			}
+			tempFile = new BlobFile(tempName, true);
+		}
+
+		Run run;
+		run.firstPage = Page::INVALID_NUMBER;
+		run.numEntries = cnt;
+		for(std::size_t i = 0; i < cnt; i += ENTRIESPERPAGE) {
+			writeRunPage(run, (const char*)&entries[i], std::min<std::size_t>(ENTRIESPERPAGE, cnt - i));
+		}
+		runs.push_back(run);
+	}
+
+  /**
+   * Append a page holding cnt entries to a run. Pages of a run are allocated one after the other,
+   * so they have consecutive page numbers.
+   */
+	void writeRunPage(Run & run, const char* entries, const std::size_t cnt)
+	{
+		Page* page;
+		PageId pageId;
+		bufMgr->allocPage(tempFile, pageId, page);
+		if(run.firstPage == Page::INVALID_NUMBER) run.firstPage = pageId;
+		memcpy((char*)page, entries, cnt * sizeof(T));
+		releasePage(pageId, true);
+	}
+
+  /**
+   * Unpin a page of the temporary file and drop the file from the pool once it holds memPages pages.
+   */
+	void releasePage(const PageId pageId, const bool dirty)
+	{
+		bufMgr->unPinPage(tempFile, pageId, dirty);
+		if(++ poolPages >= memPages) {
+			bufMgr->flushFile(tempFile);
+			poolPages = 0;
+		}
+	}
+
+  /**
+   * Copy the next page of a run into its cursor.
+   */
+	void loadPage(RunCursor & cursor)
+	{
+		Page* page;
+		bufMgr->readPage(tempFile, cursor.pageNo, page);
+		cursor.page = *page;
+		releasePage(cursor.pageNo, false);
+		cursor.pageNo ++;
+		cursor.slot = 0;
+	}
+
+  /**
+   * Take the next entry of a run and push it to the heap.
+   */
+	void advance(const int runIdx)
+	{
+		RunCursor & cursor = cursors[runIdx];
+		if(cursor.remaining == 0) return;
+		if(cursor.slot == ENTRIESPERPAGE) {
+			loadPage(cursor);
+		}
+		T entry;
+		memcpy(&entry, (char*)&cursor.page + cursor.slot * sizeof(T), sizeof(T));
+		cursor.slot ++;
+		cursor.remaining --;
+		heap.push(std::pair<T, int>(entry, runIdx));
+	}
+
+  /**
+   * Set up a k-way merge of runs [first, first + count).
+   */
+	void openMerge(const std::size_t first, const std::size_t count)
+	{
+		cursors.clear();
+		cursors.resize(count);
+		heap = std::priority_queue<std::pair<T, int>, std::vector<std::pair<T, int> >, HeapGreater>();
+		for(std::size_t i = 0; i < count; i ++) {
+			cursors[i].pageNo = runs[first + i].firstPage;
+			cursors[i].slot = ENTRIESPERPAGE;
+			cursors[i].remaining = runs[first + i].numEntries;
+			advance(i);
+		}
+	}
+
+  /**
+   * Pop the smallest entry of the current merge.
+   */
+	bool popMerge(T & outEntry)
+	{
+		if(heap.empty()) return false;
+		outEntry = heap.top().first;
+		const int runIdx = heap.top().second;
+		heap.pop();
+		advance(runIdx);
+		return true;
+	}
+
+  /**
+   * Buffer Manager Instance.
+   */
+	BufMgr *bufMgr;
+
+  /**
+   * Name of the temporary file.
+   */
+	std::string tempName;
+
+  /**
+   * Temporary file holding the runs, NULL until the first spill.
+   */
+	File *tempFile;
+
+  /**
+   * Memory budget in pages.
+   */
+	std::uint32_t memPages;
+
+  /**
+   * Number of entries the memory buffer holds before it is spilled.
+   */
+	std::size_t bufferCap;
+
+  /**
+   * Number of pages of the temporary file unpinned since it was last dropped from the buffer pool.
+   */
+	std::uint32_t poolPages;
+
+  /**
+   * Number of entries added.
+   */
+	std::size_t total;
+
+  /**
+   * True if no run was spilled and next() returns entries from the memory buffer.
+   */
+	bool inMemory;
+
+  /**
+   * Position of next entry in the memory buffer.
+   */
+	std::size_t memPos;
+
+  /**
+   * Memory buffer of entries not yet written to a run.
+   */
+	std::vector<T> buffer;
+
+  /**
+   * True if the memory buffer only holds runs added by addSortedRun().
+   */
+	bool runsOnly;
+
+  /**
+   * End offsets of the sorted runs in the memory buffer.
+   */
+	std::vector<std::size_t> runEnds;
+
+  /**
+   * Runs written to the temporary file.
+   */
+	std::vector<Run> runs;
+
+  /**
+   * Cursors of the runs of the current merge.
+   */
+	std::vector<RunCursor> cursors;
+
+  /**
+   * Heap of the current merge, holds the next entry of every run.
+   */
+	std::priority_queue<std::pair<T, int>, std::vector<std::pair<T, int> >, HeapGreater> heap;
+};
+
+}
@@ -13,6 +13,10 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -25,6 +29,7 @@ namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::DescriptorMap File::open_descriptors_;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -64,7 +69,8 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+File::File(const std::string& name, const bool create_new)
+    : filename_(name), descriptor_(-1) {
   openIfNeeded(create_new);
 
   if (create_new) {
@@ -77,8 +83,13 @@ File::File(const std::string& name, const bool create_new) : filename_(name) {
 
 void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
+    // Error if we try to overwrite a file that is open.
+    if (create_new) {
+      throw FileExistsException(filename_);
+    }
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    descriptor_ = open_descriptors_[filename_];
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -97,7 +108,9 @@ void File::openIfNeeded(const bool create_new) {
       }
     }
     stream_.reset(new std::fstream(filename_, mode));
+    descriptor_ = ::open(filename_.c_str(), O_RDONLY);
     open_streams_[filename_] = stream_;
+    open_descriptors_[filename_] = descriptor_;
     open_counts_[filename_] = 1;
   }
 }
@@ -107,14 +120,47 @@ void File::close() {
   	--open_counts_[filename_];
 
   stream_.reset();
+  descriptor_ = -1;
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
+    DescriptorMap::iterator descriptor = open_descriptors_.find(filename_);
+    if (descriptor != open_descriptors_.end()) {
+      if (descriptor->second >= 0) {
+        ::close(descriptor->second);
+      }
+      open_descriptors_.erase(descriptor);
+    }
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
+void File::readAhead(const PageId* page_numbers, const std::size_t count) const {
+#ifdef POSIX_FADV_WILLNEED
+  if (count == 0) {
+    return;
+  }
+  if (descriptor_ < 0) {
+    return;
+  }
+  std::vector<PageId> pages(page_numbers, page_numbers + count);
+  std::sort(pages.begin(), pages.end());
+  std::size_t i = 0;
+  while (i < pages.size()) {
+    std::size_t run = 1;
+    while (i + run < pages.size() && pages[i + run] <= pages[i] + run) {
+      ++run;
+    }
+    const off_t offset = static_cast<std::streamoff>(pagePosition(pages[i]));
+    const PageId last = pages[i + run - 1];
+    ::posix_fadvise(descriptor_, offset, static_cast<off_t>(last - pages[i] + 1) * Page::SIZE,
+                    POSIX_FADV_WILLNEED);
+    i += run;
+  }
+#endif
+}
+
 FileHeader File::readHeader() const {
   FileHeader header;
   stream_->seekg(0 /* pos */, std::ios::beg);
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <fstream>
 #include <string>
 #include <map>
@@ -164,6 +165,16 @@ class File {
    */
 	PageId getFirstPageNo();
 
+  /**
+   * Tells the operating system that the given pages will be read soon, so it
+   * can read them into its cache in the background. Runs of consecutive pages
+   * are passed on as one range. This is only a hint, errors are ignored.
+   *
+   * @param page_numbers  Numbers of the pages, in any order.
+   * @param count         Number of pages.
+   */
+  void readAhead(const PageId* page_numbers, const std::size_t count) const;
+
  public:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -212,6 +223,7 @@ class File {
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, int> DescriptorMap;
 
   /**
    * Streams for opened files.
@@ -223,6 +235,12 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * Read-only descriptors for opened files, the stream does not expose its
+   * own. Read-ahead hints go through them.
+   */
+  static DescriptorMap open_descriptors_;
+
   /**
    * Name of the file this object represents.
    */
@@ -233,6 +251,11 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Descriptor for underlying filesystem object, shared like <stream_>.
+   */
+  int descriptor_;
+
   friend class FileIterator;
 };
 
@@ -34,12 +34,20 @@ FileScan::~FileScan()
 }
 
 void FileScan::scanNext(RecordId& outRid)
+{
+  if (!tryScanNext(outRid))
+  {
+    throw EndOfFileException();
+  }
+}
+
+bool FileScan::tryScanNext(RecordId& outRid)
 {
   std::string rec;
 
   if (filePageIter == file->end())
 	{
-		throw EndOfFileException();
+		return false;
 	}
 
   // special case of the first record of the first page of the file
@@ -49,7 +57,7 @@ void FileScan::scanNext(RecordId& outRid)
 		filePageIter = file->begin();
     if(filePageIter == file->end())
 		{
-			throw EndOfFileException();
+			return false;
 		}
 	 
 		// read the first page of the file
@@ -65,7 +73,7 @@ void FileScan::scanNext(RecordId& outRid)
 		  rec = *pageRecordIter;
 
 			outRid = pageRecordIter.getCurrentRecord();
-			return;
+			return true;
 		}
   }
 
@@ -84,7 +92,7 @@ void FileScan::scanNext(RecordId& outRid)
     if (filePageIter == file->end())
     {
       curPage = NULL;
-			throw EndOfFileException();
+			return false;
     }
 
     // read the next page of the file
@@ -101,7 +109,7 @@ void FileScan::scanNext(RecordId& outRid)
 
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
-	return;
+	return true;
 }
 
 // returns pointer to the current record.  page is left pinned
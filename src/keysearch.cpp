@@ -0,0 +1,260 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "keysearch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEYSEARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace badgerdb
+{
+
+/**
+ * Binary search stops once this many int keys are left, they are counted with vector compares.
+ */
+static const int INTSEARCHWINDOW = 32;
+
+/**
+ * Binary search stops once this many double or 64-bit integer keys are left.
+ */
+static const int DOUBLESEARCHWINDOW = 16;
+
+// -----------------------------------------------------------------------------
+// count keys of a window -- scalar, SSE2 and AVX2 versions
+// -----------------------------------------------------------------------------
+
+/*
+Each function returns the number of keys in keys[0, n) that are less than key, or less than or equal to
+key if inclusive is set. The window is sorted, so this is the position of the bound inside the window.
+*/
+
+template <class K>
+static int countScalar(const K* keys, const int n, const K key, const bool inclusive) {
+	int cnt = 0;
+	if(inclusive) {
+		for(int i = 0; i < n; i ++) cnt += (keys[i] <= key);
+	} else {
+		for(int i = 0; i < n; i ++) cnt += (keys[i] < key);
+	}
+	return cnt;
+}
+
+#ifdef KEYSEARCH_X86
+
+/*
+The 32-bit and 64-bit integer functions are templates over the signed and the unsigned key type. Unsigned
+keys are xored with BIAS, which flips their sign bit, so that the signed vector compare orders them.
+*/
+
+template <class K>
+__attribute__((target("sse2")))
+static int countIntSSE2(const K* keys, const int n, const K key, const bool inclusive) {
+	const int BIAS = (K)-1 > 0 ? (int)0x80000000u : 0;
+	const __m128i biasVec = _mm_set1_epi32(BIAS);
+	const __m128i keyVec = _mm_set1_epi32((int)key ^ BIAS);
+	int cnt = 0;
+	int i = 0;
+	for(; i + 4 <= n; i += 4) {
+		const __m128i data = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), biasVec);
+		// k <= key is !(k > key)
+		const __m128i cmp = inclusive ? _mm_cmpgt_epi32(data, keyVec) : _mm_cmpgt_epi32(keyVec, data);
+		const int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(cmp)));
+		cnt += inclusive ? 4 - bits : bits;
+	}
+	return cnt + countScalar(keys + i, n - i, key, inclusive);
+}
+
+template <class K>
+__attribute__((target("avx2")))
+static int countIntAVX2(const K* keys, const int n, const K key, const bool inclusive) {
+	const int BIAS = (K)-1 > 0 ? (int)0x80000000u : 0;
+	const __m256i biasVec = _mm256_set1_epi32(BIAS);
+	const __m256i keyVec = _mm256_set1_epi32((int)key ^ BIAS);
+	int cnt = 0;
+	int i = 0;
+	for(; i + 8 <= n; i += 8) {
+		const __m256i data = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), biasVec);
+		const __m256i cmp = inclusive ? _mm256_cmpgt_epi32(data, keyVec) : _mm256_cmpgt_epi32(keyVec, data);
+		const int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(cmp)));
+		cnt += inclusive ? 8 - bits : bits;
+	}
+	return cnt + countScalar(keys + i, n - i, key, inclusive);
+}
+
+template <class K>
+__attribute__((target("avx2")))
+static int countInt64AVX2(const K* keys, const int n, const K key, const bool inclusive) {
+	const long long BIAS = (K)-1 > 0 ? (long long)0x8000000000000000ull : 0;
+	const __m256i biasVec = _mm256_set1_epi64x(BIAS);
+	const __m256i keyVec = _mm256_set1_epi64x((long long)key ^ BIAS);
+	int cnt = 0;
+	int i = 0;
+	for(; i + 4 <= n; i += 4) {
+		const __m256i data = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(keys + i)), biasVec);
+		const __m256i cmp = inclusive ? _mm256_cmpgt_epi64(data, keyVec) : _mm256_cmpgt_epi64(keyVec, data);
+		const int bits = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(cmp)));
+		cnt += inclusive ? 4 - bits : bits;
+	}
+	return cnt + countScalar(keys + i, n - i, key, inclusive);
+}
+
+__attribute__((target("sse2")))
+static int countDoubleSSE2(const double* keys, const int n, const double key, const bool inclusive) {
+	const __m128d keyVec = _mm_set1_pd(key);
+	int cnt = 0;
+	int i = 0;
+	for(; i + 2 <= n; i += 2) {
+		const __m128d data = _mm_loadu_pd(keys + i);
+		const __m128d cmp = inclusive ? _mm_cmple_pd(data, keyVec) : _mm_cmplt_pd(data, keyVec);
+		cnt += __builtin_popcount(_mm_movemask_pd(cmp));
+	}
+	return cnt + countScalar(keys + i, n - i, key, inclusive);
+}
+
+__attribute__((target("avx2")))
+static int countDoubleAVX2(const double* keys, const int n, const double key, const bool inclusive) {
+	const __m256d keyVec = _mm256_set1_pd(key);
+	int cnt = 0;
+	int i = 0;
+	for(; i + 4 <= n; i += 4) {
+		const __m256d data = _mm256_loadu_pd(keys + i);
+		const __m256d cmp = inclusive ? _mm256_cmp_pd(data, keyVec, _CMP_LE_OQ) : _mm256_cmp_pd(data, keyVec, _CMP_LT_OQ);
+		cnt += __builtin_popcount(_mm256_movemask_pd(cmp));
+	}
+	return cnt + countScalar(keys + i, n - i, key, inclusive);
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+// runtime dispatch
+// -----------------------------------------------------------------------------
+
+typedef int (*CountIntFn)(const int* keys, const int n, const int key, const bool inclusive);
+typedef int (*CountDoubleFn)(const double* keys, const int n, const double key, const bool inclusive);
+typedef int (*CountBigintFn)(const std::int64_t* keys, const int n, const std::int64_t key, const bool inclusive);
+typedef int (*CountUnsignedFn)(const std::uint32_t* keys, const int n, const std::uint32_t key, const bool inclusive);
+typedef int (*CountUbigintFn)(const std::uint64_t* keys, const int n, const std::uint64_t key, const bool inclusive);
+
+/**
+ * Best instruction set supported by the CPU.
+ */
+static KeySearchMode supportedMode() {
+#ifdef KEYSEARCH_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) return SEARCH_AVX2;
+	if(__builtin_cpu_supports("sse2")) return SEARCH_SSE2;
+#endif
+	return SEARCH_SCALAR;
+}
+
+static KeySearchMode searchMode = SEARCH_SCALAR;
+static CountIntFn countInt = countScalar<int>;
+static CountDoubleFn countDouble = countScalar<double>;
+static CountBigintFn countBigint = countScalar<std::int64_t>;
+static CountUnsignedFn countUnsigned = countScalar<std::uint32_t>;
+static CountUbigintFn countUbigint = countScalar<std::uint64_t>;
+
+void setKeySearchMode(const KeySearchMode mode) {
+	const KeySearchMode supported = supportedMode();
+	searchMode = mode < supported ? mode : supported;
+	countInt = countScalar<int>;
+	countDouble = countScalar<double>;
+	countBigint = countScalar<std::int64_t>;
+	countUnsigned = countScalar<std::uint32_t>;
+	countUbigint = countScalar<std::uint64_t>;
+#ifdef KEYSEARCH_X86
+	if(searchMode == SEARCH_AVX2) {
+		countInt = countIntAVX2<int>;
+		countDouble = countDoubleAVX2;
+		countBigint = countInt64AVX2<std::int64_t>;
+		countUnsigned = countIntAVX2<std::uint32_t>;
+		countUbigint = countInt64AVX2<std::uint64_t>;
+	} else if(searchMode == SEARCH_SSE2) {
+		countInt = countIntSSE2<int>;
+		countDouble = countDoubleSSE2;
+		countUnsigned = countIntSSE2<std::uint32_t>;
+	}
+#endif
+}
+
+KeySearchMode getKeySearchMode() {
+	return searchMode;
+}
+
+/**
+ * Picks the best supported instruction set when the program starts.
+ */
+static struct KeySearchInit {
+	KeySearchInit() { setKeySearchMode(SEARCH_AVX2); }
+} keySearchInit;
+
+// -----------------------------------------------------------------------------
+// lowerBound / upperBound
+// -----------------------------------------------------------------------------
+
+/*
+Branch-free binary search: the bound stays in [base, base + n] and every step halves n with a
+conditional move instead of a branch. The last window is counted by the vector function.
+*/
+
+template <class K, class CountFn>
+static inline int searchBound(const K* keys, int n, const K key, const bool inclusive,
+                              const int window, const CountFn count) {
+	const K* base = keys;
+	while(n > window) {
+		const int half = n / 2;
+		const K probe = base[half - 1];
+		base = (inclusive ? probe <= key : probe < key) ? base + half : base;
+		n -= half;
+	}
+	return (base - keys) + count(base, n, key, inclusive);
+}
+
+int lowerBound(const int* keys, const int n, const int key) {
+	return searchBound(keys, n, key, false, INTSEARCHWINDOW, countInt);
+}
+
+int upperBound(const int* keys, const int n, const int key) {
+	return searchBound(keys, n, key, true, INTSEARCHWINDOW, countInt);
+}
+
+int lowerBound(const double* keys, const int n, const double key) {
+	return searchBound(keys, n, key, false, DOUBLESEARCHWINDOW, countDouble);
+}
+
+int upperBound(const double* keys, const int n, const double key) {
+	return searchBound(keys, n, key, true, DOUBLESEARCHWINDOW, countDouble);
+}
+
+int lowerBound(const std::int64_t* keys, const int n, const std::int64_t key) {
+	return searchBound(keys, n, key, false, DOUBLESEARCHWINDOW, countBigint);
+}
+
+int upperBound(const std::int64_t* keys, const int n, const std::int64_t key) {
+	return searchBound(keys, n, key, true, DOUBLESEARCHWINDOW, countBigint);
+}
+
+int lowerBound(const std::uint32_t* keys, const int n, const std::uint32_t key) {
+	return searchBound(keys, n, key, false, INTSEARCHWINDOW, countUnsigned);
+}
+
+int upperBound(const std::uint32_t* keys, const int n, const std::uint32_t key) {
+	return searchBound(keys, n, key, true, INTSEARCHWINDOW, countUnsigned);
+}
+
+int lowerBound(const std::uint64_t* keys, const int n, const std::uint64_t key) {
+	return searchBound(keys, n, key, false, DOUBLESEARCHWINDOW, countUbigint);
+}
+
+int upperBound(const std::uint64_t* keys, const int n, const std::uint64_t key) {
+	return searchBound(keys, n, key, true, DOUBLESEARCHWINDOW, countUbigint);
+}
+
+}
@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace badgerdb
+{
+
+/*
+Search functions for the sorted key arrays of the B+ tree nodes. A branch-free binary search narrows the
+array down to a small window and the keys of the window are counted with AVX2 or SSE2 compares. The
+instruction set is picked once at runtime from what the CPU supports, with a scalar loop as fallback.
+SSE2 has no 64-bit compare, 64-bit keys are counted by the scalar loop in SSE2 mode. Unsigned keys are
+compared as signed ones after their sign bit is flipped.
+All functions return an index in [0, n].
+*/
+
+/**
+ * @brief Instruction sets the search functions can use.
+ */
+enum KeySearchMode
+{
+	SEARCH_SCALAR = 0,
+	SEARCH_SSE2 = 1,
+	SEARCH_AVX2 = 2
+};
+
+/**
+ * Index of the first key in keys[0, n) that is not less than key.
+ */
+int lowerBound(const int* keys, const int n, const int key);
+
+/**
+ * Index of the first key in keys[0, n) that is greater than key.
+ */
+int upperBound(const int* keys, const int n, const int key);
+
+/**
+ * Index of the first key in keys[0, n) that is not less than key.
+ */
+int lowerBound(const double* keys, const int n, const double key);
+
+/**
+ * Index of the first key in keys[0, n) that is greater than key.
+ */
+int upperBound(const double* keys, const int n, const double key);
+
+/**
+ * Index of the first key in keys[0, n) that is not less than key.
+ */
+int lowerBound(const std::int64_t* keys, const int n, const std::int64_t key);
+
+/**
+ * Index of the first key in keys[0, n) that is greater than key.
+ */
+int upperBound(const std::int64_t* keys, const int n, const std::int64_t key);
+
+/**
+ * Index of the first key in keys[0, n) that is not less than key.
+ */
+int lowerBound(const std::uint32_t* keys, const int n, const std::uint32_t key);
+
+/**
+ * Index of the first key in keys[0, n) that is greater than key.
+ */
+int upperBound(const std::uint32_t* keys, const int n, const std::uint32_t key);
+
+/**
+ * Index of the first key in keys[0, n) that is not less than key.
+ */
+int lowerBound(const std::uint64_t* keys, const int n, const std::uint64_t key);
+
+/**
+ * Index of the first key in keys[0, n) that is greater than key.
+ */
+int upperBound(const std::uint64_t* keys, const int n, const std::uint64_t key);
+
+/**
+ * Instruction set used by the search functions.
+ */
+KeySearchMode getKeySearchMode();
+
+/**
+ * Force the instruction set used by the search functions, e.g. to compare them in tests.
+ * Modes the CPU does not support fall back to the best supported one.
+ * @param mode	Instruction set to use
+ */
+void setKeySearchMode(const KeySearchMode mode);
+
+}
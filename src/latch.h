@@ -0,0 +1,178 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include "types.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Version latch for optimistic lock coupling. The version is even while the latch is free and odd while a
+ * writer holds it, so every write moves it on by two. Readers never write to the latch: they take the version
+ * before reading the data it protects and check afterwards that it is unchanged, and start over otherwise.
+ * Each latch fills a cache line of its own, so latches of different nodes do not share one.
+ */
+class VersionLatch {
+
+ public:
+
+	VersionLatch() : version(0) {}
+
+  /**
+   * Wait until no writer holds the latch and return its version.
+   */
+	std::uint64_t readLock() const
+	{
+		std::uint64_t v = version.load(std::memory_order_acquire);
+		while(v & 1) {
+			std::this_thread::yield();
+			v = version.load(std::memory_order_acquire);
+		}
+		return v;
+	}
+
+  /**
+   * True if the latch is still at version v, so nothing read since readLock() returned v has been changed.
+   */
+	bool validate(const std::uint64_t v) const
+	{
+		// sequentially consistent load, a writer checking the tree latch after taking a node latch must not
+		// miss lockTree() taking it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return version.load() == v;
+	}
+
+  /**
+   * Take the latch for writing if it is still at version v. Fails at once otherwise, writers never wait for
+   * each other while holding a latch.
+   */
+	bool tryUpgrade(const std::uint64_t v)
+	{
+		std::uint64_t expected = v;
+		if(!version.compare_exchange_strong(expected, v + 1)) {
+			return false;
+		}
+		// the writes to the protected data must not become visible before the odd version
+		std::atomic_thread_fence(std::memory_order_release);
+		return true;
+	}
+
+  /**
+   * Take the latch for writing if no writer holds it, without waiting.
+   */
+	bool tryLock()
+	{
+		const std::uint64_t v = version.load();
+		return !(v & 1) && tryUpgrade(v);
+	}
+
+  /**
+   * Take the latch for writing, waiting for the writer holding it.
+   */
+	void lock()
+	{
+		while(!tryUpgrade(readLock())) {
+		}
+	}
+
+  /**
+   * Release the latch taken by tryUpgrade() or lock(), readers that read while it was held start over.
+   */
+	void unlock() { version.fetch_add(1, std::memory_order_release); }
+
+  /**
+   * True while a writer holds the latch.
+   */
+	bool isLocked() const { return (version.load() & 1) != 0; }
+
+ private:
+
+	std::atomic<std::uint64_t> version;
+
+	char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+};
+
+/**
+ * @brief The latches of the nodes of one index. Nodes live in buffer frames and are read and written through the
+ * buffer manager, so their latches are kept here instead of in the pages: the latch of a node is picked by its page
+ * number from a fixed number of stripes. Nodes sharing a stripe only make each other's readers start over a
+ * little more often.
+ *
+ * Changes that move entries between many nodes (merges, range deletes, growing the root) are not coupled node by
+ * node. They take the tree latch, which every reader and writer validates along with its node latches, and wait
+ * until no writer holds a node latch, so they run alone.
+ */
+class LatchTable {
+
+ public:
+
+  /**
+   * Number of node latch stripes.
+   */
+	static const int STRIPES = 1024;
+
+  /**
+   * Latch of the node on page pageNo.
+   */
+	VersionLatch & node(const PageId pageNo) { return nodes[pageNo % STRIPES]; }
+
+  /**
+   * Latch of the tree as a whole, also protecting the root page number.
+   */
+	VersionLatch & tree() { return treeLatch; }
+
+  /**
+   * Take the tree latch and wait for the writers that still hold node latches. Writers check the tree latch
+   * after taking their node latches, so none of them gets past that check afterwards.
+   */
+	void lockTree()
+	{
+		treeLatch.lock();
+		for(int i = 0; i < STRIPES; i ++) {
+			while(nodes[i].isLocked()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+  /**
+   * Release the tree latch taken by lockTree().
+   */
+	void unlockTree() { treeLatch.unlock(); }
+
+ private:
+
+	VersionLatch treeLatch;
+
+	VersionLatch nodes[ STRIPES ];
+};
+
+/**
+ * @brief Holds the tree latch of a LatchTable for the lifetime of the object.
+ */
+class TreeLock {
+
+ public:
+
+	explicit TreeLock(LatchTable & latches) : latches(latches) { latches.lockTree(); }
+
+	~TreeLock() { latches.unlockTree(); }
+
+	TreeLock(const TreeLock&) = delete;
+	TreeLock& operator=(const TreeLock&) = delete;
+
+ private:
+
+	LatchTable & latches;
+};
+
+}
@@ -6,7 +6,13 @@
  */
 
 #include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include "btree.h"
+#include "keysearch.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
@@ -19,6 +25,8 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/key_too_long_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -44,7 +52,7 @@ const std::string relationName = "relA";
 const std::string relationNameB = "relB";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 const int	relationSize = 5000;
-std::string intIndexName, doubleIndexName, stringIndexName;
+std::string intIndexName, doubleIndexName, stringIndexName, compositeIndexName;
 
 // This is the structure for tuples in the base relation
 
@@ -71,10 +79,32 @@ void createRelationBackward();
 void createRelationRandom();
 void createSmallRelation();
 void createRelationSparse();
-void intTests();
+void intTests(const IndexBuildOptions & buildOptions = IndexBuildOptions());
 void intTestsSparse();
+void intTestsSingleRecord();
 void intTestsReopen();
+void intTestsFillFactor();
+void intTestsExternalSort();
+void intTestsParallel();
+void intTestsDuplicates();
+void intTestsBatchScan();
+void intTestsCursors();
+void intTestsTryScan();
+void intTestsDelete();
+void intTestsDeleteRange();
+void intTestsPostingLists();
+void intTestsPackedLeaves();
+void intTestsComposite();
+void intTestsWideKeys();
+void intTestsPayload();
+void intTestsReverse();
+void intTestsConcurrent();
+int intScanReverse(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t batchSize);
+int compositeCount(BTreeIndex *index, const char* lowVal, Operator lowOp, const char* highVal, Operator highOp);
 int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+int intCount(BTreeIndex *index, int lowVal, int highVal);
+int intUnderfull(BTreeIndex *index, PageId nodeId);
+int intScanBatch(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t batchSize);
 void indexTests();
 void indexTestsSparse();
 void doubleTests();
@@ -82,6 +112,9 @@ void doubleTestsSparse();
 int doubleScan(BTreeIndex *index, double lowVal, Operator lowOp, double highVal, Operator highOp);
 void stringTests();
 void stringTestsSparse();
+void stringTestsSeparators();
+void varcharTests();
+int varcharCount(BTreeIndex *index, const char* lowVal, const char* highVal);
 int stringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
 void test1();
 void test2();
@@ -89,6 +122,8 @@ void test3();
 void test4();
 void test5();
 void errorTests();
+void badIndexInfoTests();
+void keySearchTests();
 void deleteRelation();
 
 int main(int argc, char **argv)
@@ -202,6 +237,8 @@ int main(int argc, char **argv)
 	test3();
 	test5();
 	errorTests();
+	badIndexInfoTests();
+	keySearchTests();
 
   return 1;
 }
@@ -641,101 +678,1867 @@ void indexTests()
   	catch(FileNotFoundException e)
   	{
   	}
+
+    intTestsSingleRecord();
+
+    intTestsFillFactor();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+
+    intTestsExternalSort();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+
+    intTestsParallel();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+
+    intTestsDuplicates();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+
+    intTestsBatchScan();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+
+    intTestsCursors();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsTryScan();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsDelete();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsDeleteRange();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsPostingLists();
+    intTestsPackedLeaves();
+    intTestsComposite();
+		try
+		{
+			File::remove(compositeIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsWideKeys();
+    intTestsPayload();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsReverse();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    intTestsConcurrent();
+		try
+		{
+			File::remove(intIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
   }
   else if(testNum == 2)
   {
     doubleTests();
 		try
 		{
-			File::remove(doubleIndexName);
+			File::remove(doubleIndexName);
+		}
+  	catch(FileNotFoundException e)
+  	{
+  	}
+  }
+  else if(testNum == 3)
+  {
+    stringTests();
+		try
+		{
+			File::remove(stringIndexName);
+		}
+  	catch(FileNotFoundException e)
+  	{
+  	}
+    stringTestsSeparators();
+		try
+		{
+			File::remove(stringIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+    varcharTests();
+		try
+		{
+			File::remove(stringIndexName);
+		}
+  	catch(const FileNotFoundException &)
+  	{
+  	}
+  }
+}
+
+// -----------------------------------------------------------------------------
+// intTests
+// -----------------------------------------------------------------------------
+
+void intTests(const IndexBuildOptions & buildOptions)
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, buildOptions);
+
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 99) 
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+
+	// run some additional tests
+	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 5000)
+	checkPassFail(intScan(&index,4999,GTE,6000,LT), 1)
+	checkPassFail(intScan(&index,0,GTE,1,LTE), 2)
+	checkPassFail(intScan(&index,0,GTE,4999,LT), 4999)
+	checkPassFail(intScan(&index,3000,GTE,6000,LT), 2000)
+}
+
+void intTestsSingleRecord()
+{
+  std::cout << "Bulk load a B+ Tree index on the integer field of a relation with a single record" << std::endl;
+	// the relation and an index left behind by an earlier run
+	try
+	{
+		File::remove(relationNameB);
+	}
+	catch(const FileNotFoundException &)
+	{
+	}
+	try
+	{
+		File::remove(relationNameB + ".0");
+	}
+	catch(const FileNotFoundException &)
+	{
+	}
+	{
+		PageFile relation = PageFile::create(relationNameB);
+		PageId pageNo;
+		Page page = relation.allocatePage(pageNo);
+		record1.i = 7;
+		page.insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+		relation.writePage(pageNo, page);
+	}
+
+	std::string indexName;
+	{
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+		// one leaf holding the entry below a root without keys
+		Page* rootPage;
+		bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+		NonLeafNodeInt* root = (NonLeafNodeInt*)rootPage;
+		checkPassFail(root->level, 1)
+		checkPassFail(root->keyArrLength, 0)
+		const PageId leafId = root->pageNoArray[0];
+		bufMgr->unPinPage(index.file, index.rootPageNum, false);
+		Page* leafPage;
+		bufMgr->readPage(index.file, leafId, leafPage);
+		checkPassFail(((LeafNodeInt*)leafPage)->keyArrLength, 1)
+		checkPassFail(((LeafNodeInt*)leafPage)->rightSibPageNo, 0)
+		bufMgr->unPinPage(index.file, leafId, false);
+		checkPassFail(intCount(&index, 0, 10), 1)
+
+		// the tree grows from there like any other
+		RecordId rid;
+		rid.page_number = 1;
+		rid.slot_number = 1;
+		for(int i = 100; i < 2100; i ++) {
+			index.insertEntry(&i, rid);
+		}
+		checkPassFail(intCount(&index, 0, 3000), 2001)
+		int seven = 7;
+		std::vector<RecordId> rids;
+		checkPassFail((int)index.lookup(&seven, rids), 1)
+	}
+	File::remove(indexName);
+	File::remove(relationNameB);
+}
+
+void intTestsSparse()
+{
+  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 1)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 2)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 1)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 1)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 9) 
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 100)
+
+	// run some additional tests
+	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 600)
+	checkPassFail(intScan(&index,4999,GTE,6000,LT), 100)
+	checkPassFail(intScan(&index,0,GTE,1,LTE), 1)
+	checkPassFail(intScan(&index,0,GTE,4999,LT), 500)
+	checkPassFail(intScan(&index,3000,GTE,6000,LT), 300)
+}
+
+void intTestsReopen()
+{
+  std::cout << "reopen existing index " << intIndexName << std::endl;
+//   deleteRelation();
+//   PageFile new_file = PageFile::create(relationName);
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  
+	// run some tests
+	checkPassFail(intScan(&index,25,GT,40,LT), 1)
+	checkPassFail(intScan(&index,20,GTE,35,LTE), 2)
+	checkPassFail(intScan(&index,-3,GT,3,LT), 1)
+	checkPassFail(intScan(&index,996,GT,1001,LT), 1)
+	checkPassFail(intScan(&index,0,GT,1,LT), 0)
+	checkPassFail(intScan(&index,300,GT,400,LT), 9) 
+	checkPassFail(intScan(&index,3000,GTE,4000,LT), 100)
+
+	// run some additional tests
+	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 600)
+	checkPassFail(intScan(&index,4999,GTE,6000,LT), 100)
+	checkPassFail(intScan(&index,0,GTE,1,LTE), 1)
+	checkPassFail(intScan(&index,0,GTE,4999,LT), 500)
+	checkPassFail(intScan(&index,3000,GTE,6000,LT), 300)
+}
+
+void intTestsFillFactor()
+{
+  std::cout << "Bulk load a B+ Tree index on the integer field with a low fill factor" << std::endl;
+  // few keys per page, so the bulk loader has to build several non leaf levels
+  IndexBuildOptions buildOptions;
+  buildOptions.fillFactor = 0.01;
+  intTests(buildOptions);
+
+	// reopen the index and insert into the sparse pages left by the fill factor, pointing at the record of key 0
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	int zero = 0;
+	RecordId zeroRid;
+	index.startScan(&zero, GTE, &zero, LTE);
+	index.scanNext(zeroRid);
+	index.endScan();
+	for(int i = 5000; i < 5100; i ++) {
+		index.insertEntry(&i, zeroRid);
+	}
+	checkPassFail(intScan(&index,4990,GTE,6000,LT), 110)
+}
+
+void intTestsExternalSort()
+{
+  std::cout << "Create a B+ Tree index on the integer field with a tiny sort memory budget" << std::endl;
+  // 3 pages of memory hold ~2000 pairs, so the sort spills several runs and needs more than one merge pass
+  IndexBuildOptions buildOptions;
+  buildOptions.sortMemPages = 3;
+  intTests(buildOptions);
+	checkPassFail(File::exists(intIndexName + ".sort"), false)
+}
+
+void intTestsParallel()
+{
+  std::cout << "Create a B+ Tree index on the integer field with 4 build threads" << std::endl;
+  // small sort memory so the runs of the threads are spilled and merged from disk
+  IndexBuildOptions buildOptions;
+  buildOptions.buildThreads = 4;
+  buildOptions.sortMemPages = 3;
+  intTests(buildOptions);
+}
+
+void intTestsDuplicates()
+{
+  std::cout << "Insert many duplicate keys into a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// duplicates of one key, pointing at the record of key 0, span several leaves
+	int zero = 0;
+	RecordId zeroRid;
+	index.startScan(&zero, GTE, &zero, LTE);
+	index.scanNext(zeroRid);
+	index.endScan();
+	for(int i = 0; i < 3000; i ++) {
+		int key = 42;
+		index.insertEntry(&key, zeroRid);
+	}
+
+	// ascending keys leave half full leaves behind, enough of them to split the root
+	for(int i = 5000; i < 365000; i ++) {
+		index.insertEntry(&i, zeroRid);
+	}
+
+	// root is no longer right above the leaves
+	Page* rootPage;
+	bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+	checkPassFail(((NonLeafNodeInt*)rootPage)->level, 0)
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+
+	checkPassFail(intScan(&index,42,GTE,42,LTE), 3001)
+	checkPassFail(intScan(&index,25,GT,40,LT), 14)
+	checkPassFail(intScan(&index,40,GTE,44,LT), 3004)
+	checkPassFail(intScan(&index,4998,GTE,6000,LT), 1002)
+	checkPassFail(intScan(&index,-1000,GTE,400000,LT), 368000)
+
+	// point lookups, the duplicates run over several leaves
+	std::vector<RecordId> rids;
+	int key = 42;
+	checkPassFail(index.lookup(&key, rids), 3001)
+	checkPassFail(rids.size(), 3001)
+	key = 41;
+	checkPassFail(index.lookup(&key, rids), 1)
+	key = 364999;
+	checkPassFail(index.lookup(&key, rids), 1)
+	key = 4999;
+	checkPassFail(index.lookup(&key, rids), 1)
+	key = -5;
+	checkPassFail(index.lookup(&key, rids), 0)
+	key = 365000;
+	checkPassFail(index.lookup(&key, rids), 0)
+	checkPassFail(rids.size(), 0)
+
+	// batched lookups, keys unsorted and repeated
+	int keys[] = {365000, 42, 7, 42, -5, 364999, 100000, 41};
+	std::vector<std::vector<RecordId> > results;
+	checkPassFail(index.lookupBatch(keys, 8, results), 6006)
+	checkPassFail(results.size(), 8)
+	checkPassFail(results[0].size(), 0)
+	checkPassFail(results[1].size(), 3001)
+	checkPassFail(results[3].size(), 3001)
+	checkPassFail(results[6].size(), 1)
+
+	// a batch spread over the whole tree agrees with single lookups
+	std::vector<int> manyKeys;
+	for(int i = 370000; i > -1000; i -= 13) {
+		manyKeys.push_back(i);
+	}
+	index.lookupBatch(&manyKeys[0], manyKeys.size(), results);
+	int mismatches = 0;
+	for(std::size_t i = 0; i < manyKeys.size(); i ++) {
+		if(index.lookup(&manyKeys[i], rids) != results[i].size()) mismatches ++;
+	}
+	checkPassFail(mismatches, 0)
+}
+
+void intTestsBatchScan()
+{
+  std::cout << "Batched scans of a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// batches smaller and larger than a leaf, ranges ending inside and at the end of leaves
+	checkPassFail(intScanBatch(&index,25,GT,40,LT,1), 14)
+	checkPassFail(intScanBatch(&index,20,GTE,35,LTE,7), 16)
+	checkPassFail(intScanBatch(&index,-3,GT,3,LT,1000), 3)
+	checkPassFail(intScanBatch(&index,0,GT,1,LT,1000), 0)
+	checkPassFail(intScanBatch(&index,300,GT,400,LT,50), 99)
+	checkPassFail(intScanBatch(&index,3000,GTE,4000,LT,333), 1000)
+	checkPassFail(intScanBatch(&index,-1000,GTE,6000,LT,682), 5000)
+	checkPassFail(intScanBatch(&index,-1000,GTE,6000,LT,100000), 5000)
+	checkPassFail(intScanBatch(&index,4999,GTE,6000,LT,10), 1)
+	checkPassFail(intScanBatch(&index,0,GTE,4999,LT,4999), 4999)
+}
+
+void intTestsCursors()
+{
+  std::cout << "Several cursors on a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// scan of the index itself keeps running while cursors are used
+	int low = 0;
+	int high = 5000;
+	index.startScan(&low, GTE, &high, LT);
+
+	// nested loop: for each outer entry an inner cursor counts the entries up to 10 keys above it
+	int outerLow = 100;
+	int outerHigh = 200;
+	IndexCursor outer(&index);
+	outer.startScan(&outerLow, GTE, &outerHigh, LT);
+	int outerCnt = 0;
+	int innerCnt = 0;
+	for(IndexCursor::iterator it = outer.begin(); it != outer.end(); ++ it) {
+		Page *curPage;
+		bufMgr->readPage(file1, it->page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(*it).data()));
+		bufMgr->unPinPage(file1, it->page_number, false);
+
+		int innerLow = myRec.i;
+		int innerHigh = myRec.i + 10;
+		IndexCursor inner(&index);
+		inner.startScan(&innerLow, GT, &innerHigh, LTE);
+		for(IndexCursor::iterator jt = inner.begin(); jt != inner.end(); ++ jt) {
+			innerCnt ++;
+		}
+		outerCnt ++;
+	}
+	outer.endScan();
+	checkPassFail(outerCnt, 100)
+	checkPassFail(innerCnt, 1000)
+
+	// two cursors advanced in turns over overlapping ranges
+	int lowA = 1000;
+	int highA = 3000;
+	int lowB = 2000;
+	int highB = 2500;
+	IndexCursor cursorA(&index);
+	IndexCursor cursorB(&index);
+	cursorA.startScan(&lowA, GTE, &highA, LT);
+	cursorB.startScan(&lowB, GT, &highB, LTE);
+	int cntA = 0;
+	int cntB = 0;
+	IndexCursor::iterator itA = cursorA.begin();
+	IndexCursor::iterator itB = cursorB.begin();
+	while(itA != cursorA.end() || itB != cursorB.end()) {
+		if(itA != cursorA.end()) { cntA ++; ++ itA; }
+		if(itB != cursorB.end()) { cntB ++; ++ itB; }
+	}
+	checkPassFail(cntA, 2000)
+	checkPassFail(cntB, 500)
+
+	// scan of the index was not disturbed
+	int cnt = 0;
+	RecordId rid;
+	try
+	{
+		while(1)
+		{
+			index.scanNext(rid);
+			cnt ++;
+		}
+	}
+	catch(const IndexScanCompletedException &)
+	{
+	}
+	index.endScan();
+	checkPassFail(cnt, 5000)
+}
+
+void intTestsTryScan()
+{
+  std::cout << "Scans without exceptions on a B+ Tree index on the integer field" << std::endl;
+
+	// relation read to the end without EndOfFileException
+	{
+		FileScan fscan(relationName, bufMgr);
+		RecordId scanRid;
+		int cnt = 0;
+		while(fscan.tryScanNext(scanRid)) {
+			cnt ++;
+		}
+		checkPassFail(cnt, relationSize)
+		checkPassFail(fscan.tryScanNext(scanRid), false)
+	}
+
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	RecordId rid;
+
+	// many short ranges, the last one only partly inside the relation
+	int cnt = 0;
+	for(int k = 0; k < relationSize; k += 7) {
+		int low = k;
+		int high = k + 2;
+		if(!index.tryStartScan(&low, GTE, &high, LTE)) continue;
+		while(index.tryScanNext(rid)) {
+			cnt ++;
+		}
+	}
+	index.endScan();
+	checkPassFail(cnt, 714 * 3 + 2)
+
+	// empty range, no scan is left running
+	int low = relationSize + 1000;
+	int high = relationSize + 2000;
+	checkPassFail(index.tryStartScan(&low, GTE, &high, LTE), false)
+	checkPassFail(index.tryScanNext(rid), false)
+}
+
+void intTestsDelete()
+{
+  std::cout << "Delete entries from a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	std::vector<RecordId> rids;
+	int failures = 0;
+
+	// every even key of the relation
+	for(int i = 0; i < relationSize; i += 2) {
+		index.lookup(&i, rids);
+		if(!index.deleteEntry(&i, rids[0])) failures ++;
+	}
+	checkPassFail(failures, 0)
+	int key = 10;
+	checkPassFail(index.lookup(&key, rids), 0)
+	key = 11;
+	checkPassFail(index.lookup(&key, rids), 1)
+	checkPassFail(index.deleteEntry(&key, RecordId()), false)
+	checkPassFail(intScan(&index,25,GT,40,LT), 7)
+	checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize / 2)
+
+	// duplicates spanning several leaves, only the entries with the given rids go
+	for(int i = 0; i < 3000; i ++) {
+		RecordId rid;
+		rid.page_number = 100000 + i;
+		rid.slot_number = 1;
+		key = 41;
+		index.insertEntry(&key, rid);
+	}
+	for(int i = 0; i < 3000; i += 2) {
+		RecordId rid;
+		rid.page_number = 100000 + i;
+		rid.slot_number = 1;
+		key = 41;
+		if(!index.deleteEntry(&key, rid)) failures ++;
+	}
+	checkPassFail(failures, 0)
+	key = 41;
+	checkPassFail(index.lookup(&key, rids), 1501)
+	checkPassFail(intCount(&index, 40, 42), 1501)
+
+	// grow the tree to three levels and shrink it back, merged pages are reused
+	for(int i = relationSize; i < 365000; i ++) {
+		index.insertEntry(&i, rids[0]);
+	}
+	Page* rootPage;
+	bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+	checkPassFail(((NonLeafNodeInt*)rootPage)->level, 0)
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+
+	for(int i = 0; i < 360000; i ++) {
+		// spread the deletes over the key range
+		key = relationSize + (int)(((long long)i * 7919) % 360000);
+		if(!index.deleteEntry(&key, rids[0])) failures ++;
+	}
+	checkPassFail(failures, 0)
+	checkPassFail((index.freePageNum != 0), true)
+	bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+	checkPassFail(((NonLeafNodeInt*)rootPage)->level, 1)
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	checkPassFail(intCount(&index, 0, 400000), relationSize / 2 + 1500)
+	int found = 0;
+	for(int i = -1; i < 366000; i += 2) {
+		found += index.lookup(&i, rids);
+	}
+	checkPassFail(found, relationSize / 2 + 1500)
+
+	// empty the index and fill it again from the free pages
+	for(int i = 1; i < relationSize; i += 2) {
+		index.lookup(&i, rids);
+		if(!index.deleteEntry(&i, rids[0])) failures ++;
+	}
+	for(int i = 1; i < 3000; i += 2) {
+		RecordId rid;
+		rid.page_number = 100000 + i;
+		rid.slot_number = 1;
+		key = 41;
+		if(!index.deleteEntry(&key, rid)) failures ++;
+	}
+	checkPassFail(failures, 0)
+	checkPassFail(intCount(&index, -1000, 400000), 0)
+	for(int i = 0; i < 100000; i ++) {
+		index.insertEntry(&i, rids[0]);
+	}
+	checkPassFail(intCount(&index, -1000, 400000), 100000)
+}
+
+void intTestsDeleteRange()
+{
+  std::cout << "Delete key ranges from a B+ Tree index on the integer field" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	std::vector<RecordId> rids;
+
+	// range over several leaves and range inside one leaf
+	int low = 1000;
+	int high = 1999;
+	index.deleteRange(&low, GTE, &high, LTE);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail(intCount(&index, -1000, 10000), relationSize - 1000)
+	low = 999;
+	checkPassFail(index.lookup(&low, rids), 1)
+	high = 2000;
+	checkPassFail(index.lookup(&high, rids), 1)
+	low = 10;
+	high = 20;
+	index.deleteRange(&low, GT, &high, LT);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail(intCount(&index, 10, 20), 2)
+	checkPassFail(intCount(&index, -1000, 10000), relationSize - 1009)
+
+	// three levels, the range cuts through the middle of the tree
+	for(int i = relationSize; i < 365000; i ++) {
+		index.insertEntry(&i, rids[0]);
+	}
+	low = 6000;
+	high = 300000;
+	index.deleteRange(&low, GTE, &high, LT);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail((index.freePageNum != 0), true)
+	checkPassFail(intCount(&index, -1000, 400000), relationSize - 1009 + 1000 + 65000)
+	int found = 0;
+	for(int i = -1000; i < 366000; i ++) {
+		found += index.lookup(&i, rids);
+	}
+	checkPassFail(found, relationSize - 1009 + 1000 + 65000)
+
+	// duplicates of one key
+	for(int i = 0; i < 3000; i ++) {
+		low = 7;
+		index.insertEntry(&low, rids[0]);
+	}
+	low = 7;
+	checkPassFail(index.lookup(&low, rids), 3001)
+	index.deleteRange(&low, GTE, &low, LTE);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail(index.lookup(&low, rids), 0)
+	checkPassFail(intCount(&index, 0, 10), 10)
+
+	// everything, the root ends up right above the only leaf left and the index is usable again
+	low = -1000;
+	high = 400000;
+	index.deleteRange(&low, GT, &high, LT);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail(intCount(&index, -1000, 400000), 0)
+	Page* rootPage;
+	bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+	checkPassFail(((NonLeafNodeInt*)rootPage)->level, 1)
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	for(int i = 0; i < 100000; i ++) {
+		index.insertEntry(&i, rids[0]);
+	}
+	checkPassFail(intCount(&index, -1000, 400000), 100000)
+
+	// the range starts in the first leaf, the nodes on its path keep no keys
+	for(int i = 100000; i < 365000; i ++) {
+		index.insertEntry(&i, rids[0]);
+	}
+	low = 0;
+	high = 300000;
+	index.deleteRange(&low, GTE, &high, LT);
+	checkPassFail(intUnderfull(&index, index.rootPageNum), 0)
+	checkPassFail(intCount(&index, -1000, 400000), 65000)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsComposite
+// -----------------------------------------------------------------------------
+
+void intTestsComposite()
+{
+  std::cout << "Create a B+ Tree index on the integer and double fields" << std::endl;
+	std::vector<KeyColumn> columns(2);
+	columns[0].attrByteOffset = offsetof(tuple,i);
+	columns[0].attrType = INTEGER;
+	columns[1].attrByteOffset = offsetof(tuple,d);
+	columns[1].attrType = DOUBLE;
+  BTreeIndex index(relationName, compositeIndexName, bufMgr, columns);
+
+	char low[COMPOSITESIZE], high[COMPOSITESIZE];
+	const void* values[2];
+	int lowI = 42, highI = 42;
+	values[0] = &lowI;
+	index.makeKey(values, 1, low);
+	values[0] = &highI;
+	index.makeKey(values, 1, high, true);
+	checkPassFail(compositeCount(&index, low, GTE, high, LTE), 1)
+
+	lowI = 100;
+	highI = 199;
+	values[0] = &lowI;
+	index.makeKey(values, 1, low);
+	values[0] = &highI;
+	index.makeKey(values, 1, high, true);
+	checkPassFail(compositeCount(&index, low, GTE, high, LTE), 100)
+
+	// tenants with many timestamps each, negative values on both columns
+	std::vector<RecordId> rids;
+	RecordId rid;
+	char key[COMPOSITESIZE];
+	for(int tenant = -3; tenant < 7; tenant ++) {
+		for(int j = 0; j < 1000; j ++) {
+			rid.page_number = 100000 + j;
+			rid.slot_number = 1;
+			const double ts = -500.5 + (j * 7) % 1000;
+			values[0] = &tenant;
+			values[1] = &ts;
+			index.makeKey(values, 2, key);
+			index.insertEntry(key, rid);
+		}
+	}
+
+	lowI = -3;
+	highI = -3;
+	values[0] = &lowI;
+	index.makeKey(values, 1, low);
+	values[0] = &highI;
+	index.makeKey(values, 1, high, true);
+	checkPassFail(compositeCount(&index, low, GTE, high, LTE), 1000)
+
+	// the relation holds (5, 5.0) as well
+	lowI = 5;
+	highI = 5;
+	values[0] = &lowI;
+	index.makeKey(values, 1, low);
+	values[0] = &highI;
+	index.makeKey(values, 1, high, true);
+	checkPassFail(compositeCount(&index, low, GTE, high, LTE), 1001)
+
+	// range on the second column within one tenant
+	double lowD = 0, highD = 100;
+	lowI = -3;
+	values[0] = &lowI;
+	values[1] = &lowD;
+	index.makeKey(values, 2, low);
+	values[1] = &highD;
+	index.makeKey(values, 2, high);
+	checkPassFail(compositeCount(&index, low, GTE, high, LT), 100)
+
+	lowD = -500.5;
+	values[1] = &lowD;
+	index.makeKey(values, 2, key);
+	checkPassFail(index.lookup(key, rids), 1)
+
+	std::cout << "Reopen composite index with a different column type" << std::endl;
+	columns[1].attrType = INTEGER;
+	try
+	{
+		BTreeIndex other(relationName, compositeIndexName, bufMgr, columns);
+		std::cout << "BadIndexInfoException Test 4 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &)
+	{
+		std::cout << "BadIndexInfoException Test 4 Passed." << std::endl;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intTestsWideKeys
+// -----------------------------------------------------------------------------
+
+template <class K>
+int keyCount(BTreeIndex * index, K lowVal, K highVal)
+{
+	RecordId rid;
+	int cnt = 0;
+	if(index->tryStartScan(&lowVal, GTE, &highVal, LTE)) {
+		while(index->tryScanNext(rid)) cnt ++;
+		index->endScan();
+	}
+	return cnt;
+}
+
+void intTestsWideKeys()
+{
+	RecordId rid;
+	rid.page_number = 100000;
+	rid.slot_number = 1;
+	std::vector<RecordId> rids;
+	{
+		std::cout << "Create a B+ Tree index on the integer field with UNSIGNED keys" << std::endl;
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), UNSIGNED);
+		for(std::uint32_t j = 0; j < 200; j ++) {
+			std::uint32_t key = 0xffffff00u + j;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(keyCount<std::uint32_t>(&index, 0, relationSize - 1), relationSize)
+		checkPassFail(keyCount<std::uint32_t>(&index, 0x80000000u, 0xffffffffu), 200)
+		checkPassFail(keyCount<std::uint32_t>(&index, 0, 0xffffffffu), relationSize + 200)
+	}
+	File::remove(intIndexName);
+
+	// non-negative doubles order like their bit patterns, so the relation gives BIGINT keys in the order of 0 to 4999
+	std::string bigintIndexName;
+	{
+		std::cout << "Create a B+ Tree index on the double field with BIGINT keys" << std::endl;
+		BTreeIndex index(relationName, bigintIndexName, bufMgr, offsetof(tuple,d), BIGINT);
+		std::int64_t key = (std::int64_t)1 << 53;
+		index.insertEntry(&key, rid);
+		key ++;
+		index.insertEntry(&key, rid);
+		checkPassFail(index.lookup(&key, rids), 1)
+		for(int j = 0; j < 100; j ++) {
+			key = -((std::int64_t)1 << 40) - j;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(keyCount<std::int64_t>(&index, INT64_MIN, -1), 100)
+		checkPassFail(keyCount<std::int64_t>(&index, 0, INT64_MAX), relationSize + 2)
+	}
+	File::remove(bigintIndexName);
+}
+
+// -----------------------------------------------------------------------------
+// intTestsPayload
+// -----------------------------------------------------------------------------
+
+void intTestsPayload()
+{
+  std::cout << "Create a B+ Tree index on the integer field with the double and string fields as payload" << std::endl;
+	IndexBuildOptions options;
+	options.payloadColumns.resize(2);
+	options.payloadColumns[0].attrByteOffset = offsetof(tuple,d);
+	options.payloadColumns[0].size = sizeof(double);
+	options.payloadColumns[1].attrByteOffset = offsetof(tuple,s);
+	options.payloadColumns[1].size = 20;
+	const int payloadSize = sizeof(double) + 20;
+
+	// the payload of key k is always d = k and s = "k string record", the tree moves it around with the rid
+	std::vector<int> keys;
+	for(int i = 0; i < relationSize; i ++) keys.push_back(i);
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		RECORD record;
+		memset(&record, 0, sizeof(record));
+		char payload[MAXPAYLOADSIZE];
+		RecordId rid;
+		rid.slot_number = 1;
+		for(int j = 0; j < 10000; j ++) {
+			int key = relationSize + (j * 7919) % 10000;
+			record.d = key;
+			sprintf(record.s, "%05d string record", key);
+			index.makePayload((const char*)&record, payload);
+			rid.page_number = 100000 + key;
+			index.insertEntry(&key, rid, payload);
+		}
+		// every other key of the first half goes entry by entry, a block of the second half at once
+		for(int key = relationSize; key < relationSize + 10000; key ++) {
+			rid.page_number = 100000 + key;
+			if(key < relationSize + 5000 && key % 2 == 0) {
+				index.deleteEntry(&key, rid);
+			} else if(key < relationSize + 7000 || key >= relationSize + 9000) {
+				keys.push_back(key);
+			}
+		}
+		int low = relationSize + 7000, high = relationSize + 9000;
+		index.deleteRange(&low, GTE, &high, LT);
+
+		std::cout << "Scan the payloads" << std::endl;
+		low = 0;
+		high = relationSize + 10000;
+		std::vector<RecordId> rids(100);
+		std::vector<char> payloads(100 * payloadSize);
+		std::size_t cnt = 0;
+		int wrong = 0;
+		index.startScan(&low, GTE, &high, LT);
+		while(true) {
+			const std::size_t got = index.scanNextBatch(&rids[0], rids.size(), &payloads[0]);
+			if(got == 0) break;
+			for(std::size_t j = 0; j < got; j ++, cnt ++) {
+				double d;
+				memcpy(&d, &payloads[j * payloadSize], sizeof(double));
+				sprintf(record.s, "%05d string record", (int)d);
+				wrong += (cnt >= keys.size() || d != keys[cnt] ||
+				          memcmp(&payloads[j * payloadSize + sizeof(double)], record.s, 20) != 0);
+			}
+		}
+		index.endScan();
+		checkPassFail((int)cnt, (int)keys.size())
+		checkPassFail(wrong, 0)
+
+		low = 100;
+		high = 199;
+		cnt = 0;
+		wrong = 0;
+		index.startScan(&low, GTE, &high, LTE);
+		while(index.tryScanNext(rid, payload)) {
+			double d;
+			memcpy(&d, payload, sizeof(double));
+			wrong += (d != 100 + (int)cnt);
+			cnt ++;
+		}
+		index.endScan();
+		checkPassFail((int)cnt, 100)
+		checkPassFail(wrong, 0)
+
+		cnt = 0;
+		wrong = 0;
+		index.startScan(&low, GTE, &high, LTE, true);
+		while(index.tryScanNext(rid, payload)) {
+			double d;
+			memcpy(&d, payload, sizeof(double));
+			wrong += (d != 199 - (int)cnt);
+			cnt ++;
+		}
+		index.endScan();
+		checkPassFail((int)cnt, 100)
+		checkPassFail(wrong, 0)
+	}
+
+	std::cout << "Reopen index with other payload columns" << std::endl;
+	options.payloadColumns.pop_back();
+	try
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		std::cout << "BadIndexInfoException Test 5 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &)
+	{
+		std::cout << "BadIndexInfoException Test 5 Passed." << std::endl;
+	}
+
+	std::cout << "Build the index in threads, the payloads go through the sort with the keys" << std::endl;
+	File::remove(intIndexName);
+	options.buildThreads = 4;
+	options.sortMemPages = 3;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		char payload[MAXPAYLOADSIZE];
+		RecordId rid;
+		int low = 0, high = relationSize;
+		int cnt = 0;
+		int wrong = 0;
+		index.startScan(&low, GTE, &high, LT);
+		while(index.tryScanNext(rid, payload)) {
+			double d;
+			memcpy(&d, payload, sizeof(double));
+			wrong += (d != cnt);
+			cnt ++;
+		}
+		index.endScan();
+		checkPassFail(cnt, relationSize)
+		checkPassFail(wrong, 0)
+	}
+}
+
+// -----------------------------------------------------------------------------
+// intTestsReverse
+// -----------------------------------------------------------------------------
+
+// key of an entry, the entries inserted by the test carry it in the page number of their rid
+int ridKey(const RecordId & rid)
+{
+	if(rid.page_number >= 100000) {
+		return rid.page_number - 100000;
+	}
+	Page *curPage;
+	bufMgr->readPage(file1, rid.page_number, curPage);
+	RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rid).data()));
+	bufMgr->unPinPage(file1, rid.page_number, false);
+	return myRec.i;
+}
+
+void intTestsReverse()
+{
+  std::cout << "Scan a B+ Tree index on the integer field in descending key order" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	checkPassFail(intScanReverse(&index,25,GT,40,LT,1), 14)
+	checkPassFail(intScanReverse(&index,20,GTE,35,LTE,1), 16)
+	checkPassFail(intScanReverse(&index,-3,GT,3,LT,1), 3)
+	checkPassFail(intScanReverse(&index,996,GT,1001,LT,1), 4)
+	checkPassFail(intScanReverse(&index,0,GT,1,LT,1), 0)
+	checkPassFail(intScanReverse(&index,300,GT,400,LT,1), 99)
+	checkPassFail(intScanReverse(&index,3000,GTE,4000,LT,64), 1000)
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize,LT,100), relationSize)
+	checkPassFail(intScanReverse(&index,relationSize,GTE,relationSize + 10,LT,1), 0)
+	int low = -10;
+	int high = -1;
+	checkPassFail(index.tryStartScan(&low, GTE, &high, LTE, true), false)
+
+	// the latest ten entries of a range
+	low = 0;
+	high = relationSize;
+	RecordId rids[10];
+	index.startScan(&low, GTE, &high, LT, true);
+	checkPassFail((int)index.scanNextBatch(rids, 10), 10)
+	index.endScan();
+	checkPassFail(ridKey(rids[0]), relationSize - 1)
+	checkPassFail(ridKey(rids[9]), relationSize - 10)
+
+	// the left sibling links stay right through splits, merges and range deletes
+	RecordId rid;
+	rid.slot_number = 1;
+	for(int j = 0; j < 100000; j ++) {
+		int key = relationSize + (int)(((long long)j * 7919) % 100000);
+		rid.page_number = 100000 + key;
+		index.insertEntry(&key, rid);
+	}
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize + 100000,LT,1), relationSize + 100000)
+
+	// the read-ahead window grows up to its maximum on long scans in both directions, short ones leave it alone
+	IndexCursor cursor(&index);
+	RecordId scanRid;
+	low = 0;
+	high = relationSize + 100000;
+	for(int reverse = 0; reverse < 2; reverse ++) {
+		cursor.startScan(&low, GTE, &high, LT, reverse == 1);
+		while(cursor.tryScanNext(scanRid)) {
+		}
+		checkPassFail(cursor.readAheadWindow, MAXREADAHEAD)
+	}
+	high = 10;
+	cursor.startScan(&low, GTE, &high, LT);
+	while(cursor.tryScanNext(scanRid)) {
+	}
+	cursor.endScan();
+	checkPassFail(cursor.readAheadWindow, MINREADAHEAD)
+
+	for(int j = 0; j < 100000; j ++) {
+		int key = relationSize + (int)(((long long)j * 7919) % 100000);
+		if(key % 3 != 0) {
+			rid.page_number = 100000 + key;
+			index.deleteEntry(&key, rid);
+		}
+	}
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize + 100000,LT,1), relationSize + 33333)
+	low = relationSize + 20000;
+	high = relationSize + 60000;
+	index.deleteRange(&low, GTE, &high, LT);
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize + 100000,LT,1), relationSize + 20000)
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize + 100000,LT,64), relationSize + 20000)
+	checkPassFail(intCount(&index, 0, relationSize + 100000), relationSize + 20000)
+}
+
+// -----------------------------------------------------------------------------
+// intTestsConcurrent
+// -----------------------------------------------------------------------------
+
+void intTestsConcurrent()
+{
+  std::cout << "Insert, delete, look up and scan a B+ Tree index on the integer field from several threads" << std::endl;
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+
+	// writers insert keys above the relation, each a slice of its own, then delete two thirds of them again.
+	// Readers look up and scan the keys of the relation, which the splits and merges move around under them
+	const int writers = 4;
+	const int perWriter = 10000;
+	std::atomic<int> writing(writers);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> threads;
+	for(int t = 0; t < writers; t ++) {
+		threads.push_back(std::thread([&, t]() {
+			RecordId rid;
+			rid.slot_number = 1;
+			for(int j = t; j < writers * perWriter; j += writers) {
+				int key = relationSize + (int)(((long long)j * 7919) % (writers * perWriter));
+				rid.page_number = 100000 + key;
+				index.insertEntry(&key, rid);
+			}
+			for(int j = t; j < writers * perWriter; j += writers) {
+				int key = relationSize + (int)(((long long)j * 7919) % (writers * perWriter));
+				rid.page_number = 100000 + key;
+				if(key % 3 != 0 && !index.deleteEntry(&key, rid)) errors ++;
+			}
+			writing --;
+		}));
+	}
+	for(int t = 0; t < 2; t ++) {
+		threads.push_back(std::thread([&, t]() {
+			IndexCursor cursor(&index);
+			std::vector<RecordId> rids;
+			RecordId batch[64];
+			int low = 0;
+			int high = relationSize;
+			for(int round = 0; writing > 0 || round == 0; round ++) {
+				const int key = (round * 37) % relationSize;
+				if(index.lookup(&key, rids) != 1) errors ++;
+
+				// the relation keys all come back once, the inserted keys strictly ascending
+				int cnt = 0;
+				if(cursor.tryStartScan(&low, GTE, &high, LT, t == 1)) {
+					std::size_t got;
+					while((got = cursor.scanNextBatch(batch, 64)) > 0) cnt += got;
+				}
+				if(cnt != relationSize) errors ++;
+				int above = relationSize;
+				int aboveHigh = relationSize + writers * perWriter;
+				int prev = -1;
+				RecordId rid;
+				if(cursor.tryStartScan(&above, GTE, &aboveHigh, LT)) {
+					while(cursor.tryScanNext(rid)) {
+						if((int)rid.page_number <= prev) errors ++;
+						prev = rid.page_number;
+					}
+				}
+			}
+		}));
+	}
+	for(std::size_t t = 0; t < threads.size(); t ++) threads[t].join();
+
+	int kept = 0;
+	for(int key = relationSize; key < relationSize + writers * perWriter; key ++) kept += (key % 3 == 0);
+	checkPassFail(errors.load(), 0)
+	checkPassFail(intCount(&index, 0, relationSize + writers * perWriter), relationSize + kept)
+	checkPassFail(intScanReverse(&index,0,GTE,relationSize + writers * perWriter,LT,16), relationSize + kept)
+	std::vector<RecordId> rids;
+	int key = relationSize + 3 - relationSize % 3;
+	checkPassFail((int)index.lookup(&key, rids), 1)
+	key ++;
+	checkPassFail((int)index.lookup(&key, rids), 0)
+
+	// throughput of the same work split among more and more threads, read only and with one insert in ten.
+	// The numbers are printed, not checked, they depend on the cores of the machine
+	const int ops = 200000;
+	int inserted = 0;
+	for(int mixed = 0; mixed < 2; mixed ++) {
+		for(int n = 1; n <= 8; n *= 2) {
+			std::atomic<int> misses(0);
+			std::vector<std::thread> workers;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for(int t = 0; t < n; t ++) {
+				workers.push_back(std::thread([&, t, n, mixed]() {
+					std::vector<RecordId> rids;
+					RecordId rid;
+					rid.slot_number = 1;
+					for(int j = t; j < ops; j += n) {
+						if(mixed && j % 10 == 0) {
+							int key = relationSize + 100000 + inserted + j;
+							rid.page_number = key;
+							index.insertEntry(&key, rid);
+							continue;
+						}
+						const int key = (int)(((long long)j * 7919) % relationSize);
+						if(index.lookup(&key, rids) != 1) misses ++;
+					}
+				}));
+			}
+			for(int t = 0; t < n; t ++) workers[t].join();
+			const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << (mixed ? "mixed, " : "read only, ") << n << " threads: " << (long long)(ops / secs)
+			          << " operations per second" << std::endl;
+			checkPassFail(misses.load(), 0)
+			if(mixed) inserted += ops;
+		}
+	}
+	checkPassFail(intCount(&index, relationSize + 100000, relationSize + 100000 + inserted), inserted / 10)
+}
+
+// number of entries of a reverse scan, -1 if they do not come in descending key order
+int intScanReverse(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t batchSize)
+{
+	if(!index->tryStartScan(&lowVal, lowOp, &highVal, highOp, true)) {
+		return 0;
+	}
+	std::vector<RecordId> rids(batchSize);
+	int cnt = 0;
+	int prev = highVal;
+	bool descending = true;
+	while(true) {
+		const std::size_t got = (batchSize == 1) ? index->tryScanNext(rids[0]) :
+		                                           index->scanNextBatch(&rids[0], batchSize);
+		if(got == 0) break;
+		for(std::size_t j = 0; j < got; j ++, cnt ++) {
+			const int key = ridKey(rids[j]);
+			descending = descending && key <= prev;
+			prev = key;
+		}
+	}
+	index->endScan();
+	return descending ? cnt : -1;
+}
+
+int compositeCount(BTreeIndex * index, const char* lowVal, Operator lowOp, const char* highVal, Operator highOp)
+{
+	RecordId rid;
+	int cnt = 0;
+	if(index->tryStartScan(lowVal, lowOp, highVal, highOp)) {
+		while(index->tryScanNext(rid)) cnt ++;
+		index->endScan();
+	}
+	return cnt;
+}
+
+// -----------------------------------------------------------------------------
+// intTestsPostingLists
+// -----------------------------------------------------------------------------
+
+int relBKey(PageFile & relation, const RecordId & rid)
+{
+	Page page = relation.readPage(rid.page_number);
+	return reinterpret_cast<const RECORD*>(page.getRecord(rid).data())->i;
+}
+
+// number of entries in the leaves of a tree whose root is right above them
+int leafEntries(BTreeIndex & index)
+{
+	Page* page;
+	bufMgr->readPage(index.file, index.rootPageNum, page);
+	const int level = ((NonLeafNodeInt*)page)->level;
+	PageId leafId = ((NonLeafNodeInt*)page)->pageNoArray[0];
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	if(level != 1) return -1;
+	int cnt = 0;
+	while(leafId != 0) {
+		bufMgr->readPage(index.file, leafId, page);
+		cnt += ((LeafNodeInt*)page)->keyArrLength;
+		const PageId rightId = ((LeafNodeInt*)page)->rightSibPageNo;
+		bufMgr->unPinPage(index.file, leafId, false);
+		leafId = rightId;
+	}
+	return cnt;
+}
+
+void intTestsPostingLists()
+{
+  std::cout << "Create a B+ Tree index with posting lists on an integer field with few distinct values" << std::endl;
+	const std::string stringIndexName = relationNameB + "." + std::to_string(offsetof(tuple,s));
+	const std::string removeNames[] = {relationNameB, relationNameB + ".0", stringIndexName};
+	for(int i = 0; i < 3; i ++) {
+		try
+		{
+			File::remove(removeNames[i]);
 		}
-  	catch(FileNotFoundException e)
-  	{
-  	}
-  }
-  else if(testNum == 3)
-  {
-    stringTests();
-		try
+		catch(const FileNotFoundException &)
 		{
-			File::remove(stringIndexName);
 		}
-  	catch(FileNotFoundException e)
-  	{
-  	}
-  }
+	}
+
+	// ten keys, every record of a page has a different one
+	const int numRecords = 20000;
+	{
+		PageFile relation = PageFile::create(relationNameB);
+		PageId pageNo;
+		Page page = relation.allocatePage(pageNo);
+		for(int k = 0; k < numRecords; k ++) {
+			record1.i = k % 10;
+			record1.d = k;
+			sprintf(record1.s, "%05d string record", k % 10);
+			const std::string data(reinterpret_cast<char*>(&record1), sizeof(record1));
+			if(!page.hasSpaceForRecord(data)) {
+				relation.writePage(pageNo, page);
+				page = relation.allocatePage(pageNo);
+			}
+			page.insertRecord(data);
+		}
+		relation.writePage(pageNo, page);
+	}
+
+	std::string indexName;
+	{
+		// one entry per record, the leaves of a plain index need a root with keys
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		Page* rootPage;
+		bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+		checkPassFail(((NonLeafNodeInt*)rootPage)->keyArrLength, (numRecords - 1) / index.leafOccupancy)
+		bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	}
+	File::remove(indexName);
+
+	IndexBuildOptions options;
+	options.postingLists = true;
+	{
+		// every key is stored once, all of them fit into the leaves right below the root
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		checkPassFail(leafEntries(index), 10)
+
+		// a lookup returns the record ids of the key in record id order
+		PageFile relation = PageFile::open(relationNameB);
+		std::vector<RecordId> rids;
+		int key = 3;
+		checkPassFail((int)index.lookup(&key, rids), numRecords / 10)
+		int wrong = 0;
+		for(std::size_t j = 0; j < rids.size(); j ++) {
+			wrong += (relBKey(relation, rids[j]) != 3);
+			if(j > 0) {
+				wrong += (rids[j].page_number < rids[j - 1].page_number
+				          || (rids[j].page_number == rids[j - 1].page_number && rids[j].slot_number <= rids[j - 1].slot_number));
+			}
+		}
+		checkPassFail(wrong, 0)
+		const RecordId lastOfThree = rids.back();
+
+		// scans, one record id at a time, in batches and in reverse
+		checkPassFail(intCount(&index, 2, 4), 3 * numRecords / 10)
+		checkPassFail(intCount(&index, -5, 20), numRecords)
+		checkPassFail(intCount(&index, 10, 20), 0)
+		{
+			IndexCursor cursor(&index);
+			int low = 0;
+			int high = 9;
+			std::vector<RecordId> batch(100);
+			int cnt = 0;
+			cursor.startScan(&low, GTE, &high, LTE);
+			std::size_t got;
+			while((got = cursor.scanNextBatch(&batch[0], batch.size())) > 0) cnt += got;
+			cursor.endScan();
+			checkPassFail(cnt, numRecords)
+
+			low = 2;
+			high = 3;
+			RecordId rid;
+			cnt = 0;
+			cursor.startScan(&low, GTE, &high, LTE, true);
+			cursor.scanNext(rid);
+			checkPassFail((rid == lastOfThree), true)
+			for(cnt = 1; cursor.tryScanNext(rid); cnt ++) {}
+			cursor.endScan();
+			checkPassFail(cnt, 2 * numRecords / 10)
+		}
+
+		// a long list spills over several overflow pages, a new key starts a list of its own
+		RecordId rid;
+		rid.slot_number = 1;
+		for(int j = 0; j < 3000; j ++) {
+			rid.page_number = 50000 + (j * 7) % 3000;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail((int)index.lookup(&key, rids), numRecords / 10 + 3000)
+		checkPassFail(rids.back().page_number, (PageId)52999)
+		int other = 42;
+		const RecordId otherRid = rid;
+		index.insertEntry(&other, otherRid);
+		checkPassFail(intCount(&index, 0, 100), numRecords + 3001)
+
+		// delete by record id
+		for(int j = 0; j < 3000; j ++) {
+			rid.page_number = 50000 + j;
+			wrong += !index.deleteEntry(&key, rid);
+		}
+		checkPassFail(wrong, 0)
+		checkPassFail(index.deleteEntry(&key, rid), false)
+		checkPassFail(index.deleteEntry(&other, otherRid), true)
+		checkPassFail((int)index.lookup(&other, rids), 0)
+		checkPassFail((int)index.lookup(&key, rids), numRecords / 10)
+
+		// a short list is kept in the directory entry, it shrinks and grows again
+		index.insertEntry(&other, otherRid);
+		index.insertEntry(&other, rids[0]);
+		checkPassFail(index.deleteEntry(&other, otherRid), true)
+		checkPassFail((int)index.lookup(&other, rids), 1)
+		checkPassFail(index.deleteEntry(&other, rids[0]), true)
+		checkPassFail(leafEntries(index), 10)
+
+		// the last record id of a key takes its directory entry along
+		int five = 5;
+		index.lookup(&five, rids);
+		for(std::size_t j = 0; j < rids.size(); j ++) {
+			wrong += !index.deleteEntry(&five, rids[j]);
+		}
+		checkPassFail(wrong, 0)
+		checkPassFail(intCount(&index, 5, 5), 0)
+		checkPassFail(leafEntries(index), 9)
+		checkPassFail((index.freePageNum != 0), true)
+
+		// a scan continues after the last record id it returned when the list changes under it
+		{
+			IndexCursor cursor(&index);
+			cursor.startScan(&key, GTE, &key, LTE);
+			int cnt = 0;
+			for(; cnt < 10; cnt ++) cursor.scanNext(rid);
+			RecordId first;
+			first.page_number = 0;
+			first.slot_number = 5;
+			index.insertEntry(&key, first);
+			index.lookup(&key, rids);
+			index.deleteEntry(&key, rids[12]);
+			while(cursor.tryScanNext(rid)) cnt ++;
+			cursor.endScan();
+			checkPassFail(cnt, numRecords / 10 - 1)
+			index.deleteEntry(&key, first);
+			index.insertEntry(&key, rids[12]);
+		}
+
+		// writers add record ids to the lists of a few new keys and take half of them out again, while a reader
+		// looks up and scans a list that does not change
+		{
+			const int writers = 4;
+			std::atomic<int> writing(writers);
+			std::atomic<int> errors(0);
+			std::vector<std::thread> threads;
+			for(int t = 0; t < writers; t ++) {
+				threads.push_back(std::thread([&, t]() {
+					RecordId rid;
+					rid.slot_number = t + 1;
+					for(int j = 0; j < 2000; j ++) {
+						int k = 200 + j % 5;
+						rid.page_number = 60000 + j;
+						index.insertEntry(&k, rid);
+					}
+					for(int j = 0; j < 2000; j += 2) {
+						int k = 200 + j % 5;
+						rid.page_number = 60000 + j;
+						if(!index.deleteEntry(&k, rid)) errors ++;
+					}
+					writing --;
+				}));
+			}
+			threads.push_back(std::thread([&]() {
+				IndexCursor cursor(&index);
+				std::vector<RecordId> found;
+				RecordId rid;
+				while(writing > 0) {
+					if((int)index.lookup(&key, found) != numRecords / 10) errors ++;
+					int cnt = 0;
+					if(cursor.tryStartScan(&key, GTE, &key, LTE)) {
+						while(cursor.tryScanNext(rid)) cnt ++;
+					}
+					if(cnt != numRecords / 10) errors ++;
+				}
+			}));
+			for(std::size_t t = 0; t < threads.size(); t ++) threads[t].join();
+
+			checkPassFail(errors.load(), 0)
+			checkPassFail(intCount(&index, 200, 204), writers * 1000)
+			int low = 200;
+			int high = 204;
+			checkPassFail((int)index.lookup(&low, rids), writers * 200)
+			index.deleteRange(&low, GTE, &high, LTE);
+			checkPassFail(intCount(&index, 200, 204), 0)
+		}
+
+		index.deleteRange(&key, GT, &other, LT);
+		checkPassFail(intCount(&index, 0, 100), 4 * numRecords / 10)
+		checkPassFail((int)index.lookup(&key, rids), numRecords / 10)
+	}
+
+	std::cout << "Reopen index without posting lists" << std::endl;
+	try
+	{
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		std::cout << "BadIndexInfoException Test 2 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &)
+	{
+		std::cout << "BadIndexInfoException Test 2 Passed." << std::endl;
+	}
+	{
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+		int key = 0;
+		std::vector<RecordId> rids;
+		checkPassFail((int)index.lookup(&key, rids), numRecords / 10)
+	}
+	File::remove(indexName);
+
+	std::cout << "Posting lists on the string field" << std::endl;
+	{
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,s), STRING, options);
+		char keyStr[100];
+		sprintf(keyStr, "%05d string record", 7);
+		char key[STRINGSIZE];
+		strncpy(key, keyStr, STRINGSIZE);
+		std::vector<RecordId> rids;
+		checkPassFail((int)index.lookup(key, rids), numRecords / 10)
+		PageFile relation = PageFile::open(relationNameB);
+		checkPassFail(relBKey(relation, rids[0]), 7)
+	}
+	File::remove(indexName);
+
+	std::cout << "Posting lists on BIGINT, UNSIGNED, UBIGINT and VARCHAR keys" << std::endl;
+	{
+		// the first eight bytes of the string field take ten values as well
+		char keyStr[VARCHARSIZE];
+		memset(keyStr, 0, VARCHARSIZE);
+		sprintf(keyStr, "%05d string record", 7);
+		std::int64_t wideKey;
+		memcpy(&wideKey, keyStr, sizeof(wideKey));
+		std::uint32_t unsignedKey = 7;
+		const int offsets[] = {offsetof(tuple,s), offsetof(tuple,i), offsetof(tuple,s), offsetof(tuple,s)};
+		const Datatype types[] = {BIGINT, UNSIGNED, UBIGINT, VARCHAR};
+		const void* keys[] = {&wideKey, &unsignedKey, &wideKey, keyStr};
+		PageFile relation = PageFile::open(relationNameB);
+		for(int t = 0; t < 4; t ++) {
+			{
+				BTreeIndex index(relationNameB, indexName, bufMgr, offsets[t], types[t], options);
+				std::vector<RecordId> rids;
+				checkPassFail((int)index.lookup(keys[t], rids), numRecords / 10)
+				checkPassFail(relBKey(relation, rids[0]), 7)
+
+				RecordId rid;
+				rid.page_number = 50000;
+				rid.slot_number = 1;
+				index.insertEntry(keys[t], rid);
+				checkPassFail((int)index.lookup(keys[t], rids), numRecords / 10 + 1)
+				checkPassFail((rids.back() == rid), true)
+				checkPassFail(index.deleteEntry(keys[t], rid), true)
+				checkPassFail((int)index.lookup(keys[t], rids), numRecords / 10)
+			}
+			File::remove(indexName);
+		}
+	}
+
+	try
+	{
+		BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+		std::cout << "BadIndexInfoException Test 3 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &)
+	{
+		std::cout << "BadIndexInfoException Test 3 Passed." << std::endl;
+	}
+	File::remove(relationNameB);
 }
 
 // -----------------------------------------------------------------------------
-// intTests
+// intTestsPackedLeaves
 // -----------------------------------------------------------------------------
 
-void intTests()
+// number of entries in the packed leaves of an index, and the number of packed leaves
+int packedEntries(BTreeIndex & index, int & leaves)
 {
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 14)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 3)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 4)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 99) 
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
-
-	// run some additional tests
-	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 5000)
-	checkPassFail(intScan(&index,4999,GTE,6000,LT), 1)
-	checkPassFail(intScan(&index,0,GTE,1,LTE), 2)
-	checkPassFail(intScan(&index,0,GTE,4999,LT), 4999)
-	checkPassFail(intScan(&index,3000,GTE,6000,LT), 2000)
+	Page* page;
+	bufMgr->readPage(index.file, index.rootPageNum, page);
+	PageId leafId = ((NonLeafNodeInt*)page)->pageNoArray[0];
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	int cnt = 0;
+	leaves = 0;
+	while(leafId != 0) {
+		bufMgr->readPage(index.file, leafId, page);
+		LeafNodeInt* leaf = (LeafNodeInt*)page;
+		for(int i = 0; i < leaf->keyArrLength; i ++) {
+			Page* packedPage;
+			bufMgr->readPage(index.file, leaf->ridArray[i].page_number, packedPage);
+			cnt += ((PackedLeaf*)packedPage)->count;
+			bufMgr->unPinPage(index.file, leaf->ridArray[i].page_number, false);
+			leaves ++;
+		}
+		const PageId rightId = leaf->rightSibPageNo;
+		bufMgr->unPinPage(index.file, leafId, false);
+		leafId = rightId;
+	}
+	return cnt;
 }
 
-void intTestsSparse()
+void intTestsPackedLeaves()
 {
-  std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-  
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 1)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 2)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 1)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 1)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 9) 
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 100)
+  std::cout << "Create a B+ Tree index with packed leaves on an integer field" << std::endl;
+	try
+	{
+		File::remove(relationNameB);
+	}
+	catch(const FileNotFoundException &)
+	{
+	}
 
-	// run some additional tests
-	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 600)
-	checkPassFail(intScan(&index,4999,GTE,6000,LT), 100)
-	checkPassFail(intScan(&index,0,GTE,1,LTE), 1)
-	checkPassFail(intScan(&index,0,GTE,4999,LT), 500)
-	checkPassFail(intScan(&index,3000,GTE,6000,LT), 300)
+	// every key twice, the records of a key next to each other
+	const int numRecords = 20000;
+	{
+		PageFile relation = PageFile::create(relationNameB);
+		PageId pageNo;
+		Page page = relation.allocatePage(pageNo);
+		for(int k = 0; k < numRecords; k ++) {
+			record1.i = k / 2;
+			record1.d = k;
+			sprintf(record1.s, "%05d string record", k);
+			const std::string data(reinterpret_cast<char*>(&record1), sizeof(record1));
+			if(!page.hasSpaceForRecord(data)) {
+				relation.writePage(pageNo, page);
+				page = relation.allocatePage(pageNo);
+			}
+			page.insertRecord(data);
+		}
+		relation.writePage(pageNo, page);
+	}
+
+	{
+		// entries inserted by the test carry their key in the page number of their rid
+		PageFile relation = PageFile::open(relationNameB);
+		auto keyOf = [&](const RecordId & rid) {
+			return (rid.page_number >= 100000) ? (int)rid.page_number - 200000 : relBKey(relation, rid);
+		};
+
+		std::string indexName;
+		IndexBuildOptions options;
+		options.packedLeaves = true;
+		{
+			// close keys take a few bits each, so a packed leaf holds several times the entries of a plain one
+			BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			int leaves;
+			checkPassFail(packedEntries(index, leaves), numRecords)
+			checkPassFail((numRecords / leaves >= 3 * INTARRAYLEAFSIZE), true)
+
+			// every key is found with the record ids of its two records
+			std::vector<RecordId> rids;
+			int wrong = 0;
+			for(int key = 0; key < numRecords / 2; key ++) {
+				wrong += (index.lookup(&key, rids) != 2 || keyOf(rids[0]) != key || keyOf(rids[1]) != key);
+			}
+			checkPassFail(wrong, 0)
+			int key = numRecords;
+			checkPassFail((int)index.lookup(&key, rids), 0)
+			key = -1;
+			checkPassFail((int)index.lookup(&key, rids), 0)
+
+			// scans, one record id at a time, in batches and in reverse, over the bounds of the leaves
+			checkPassFail(intCount(&index, 100, 199), 200)
+			checkPassFail(intCount(&index, -5, numRecords), numRecords)
+			checkPassFail(intCount(&index, numRecords, 2 * numRecords), 0)
+			{
+				IndexCursor cursor(&index);
+				int low = 1000;
+				int high = 8000;
+				std::vector<RecordId> batch(100);
+				cursor.startScan(&low, GT, &high, LT);
+				int cnt = 0;
+				int prev = low;
+				std::size_t got;
+				while((got = cursor.scanNextBatch(&batch[0], batch.size())) > 0) {
+					for(std::size_t j = 0; j < got; j ++, cnt ++) {
+						wrong += (keyOf(batch[j]) < prev);
+						prev = keyOf(batch[j]);
+					}
+				}
+				cursor.endScan();
+				checkPassFail(cnt, 2 * (high - low - 1))
+				checkPassFail(wrong, 0)
+
+				RecordId rid;
+				cursor.startScan(&low, GTE, &high, LTE, true);
+				prev = high;
+				for(cnt = 0; cursor.tryScanNext(rid); cnt ++) {
+					wrong += (keyOf(rid) > prev);
+					prev = keyOf(rid);
+				}
+				cursor.endScan();
+				checkPassFail(cnt, 2 * (high - low + 1))
+				checkPassFail(prev, low)
+				checkPassFail(wrong, 0)
+			}
+
+			// a long run of one key and keys far apart split the leaves they go to
+			RecordId rid;
+			rid.slot_number = 1;
+			key = 500;
+			rid.page_number = 200000 + key;
+			for(int j = 0; j < 3000; j ++) {
+				rid.slot_number = j;
+				index.insertEntry(&key, rid);
+			}
+			for(int j = 0; j < 1000; j ++) {
+				int far = (j % 2 == 0) ? -1000 * j - 1 : numRecords + 1000 * j;
+				RecordId farRid;
+				farRid.page_number = 200000 + far;
+				farRid.slot_number = 0;
+				index.insertEntry(&far, farRid);
+			}
+			checkPassFail(packedEntries(index, leaves), numRecords + 4000)
+			checkPassFail((int)index.lookup(&key, rids), 3002)
+			checkPassFail(intCount(&index, 499, 501), 3006)
+			checkPassFail(intCount(&index, INT_MIN, INT_MAX), numRecords + 4000)
+			checkPassFail(intCount(&index, 0, numRecords / 2 - 1), numRecords + 3000)
+			checkPassFail(intCount(&index, 400, 599), 3400)
+
+			// a scan continues after the last entry it returned when its leaf changes under it
+			{
+				IndexCursor cursor(&index);
+				int low = 0;
+				int high = numRecords / 2 - 1;
+				cursor.startScan(&low, GTE, &high, LTE);
+				int cnt = 0;
+				for(; cnt < 1002; cnt ++) cursor.scanNext(rid);
+				checkPassFail(keyOf(rid), 500)
+				int behind = 10;
+				index.lookup(&behind, rids);
+				index.deleteEntry(&behind, rids[0]);
+				int ahead = 5000;
+				RecordId aheadRid;
+				aheadRid.page_number = 200000 + ahead;
+				for(int j = 0; j < 2000; j ++) {
+					aheadRid.slot_number = j;
+					index.insertEntry(&ahead, aheadRid);
+				}
+				while(cursor.tryScanNext(rid)) cnt ++;
+				cursor.endScan();
+				checkPassFail(cnt, numRecords + 3000 + 2000)
+				index.insertEntry(&behind, rids[0]);
+				for(int j = 0; j < 2000; j ++) {
+					aheadRid.slot_number = j;
+					wrong += !index.deleteEntry(&ahead, aheadRid);
+				}
+			}
+
+			// delete by record id, leaves left empty go
+			rid.page_number = 200000 + key;
+			for(int j = 0; j < 3000; j ++) {
+				rid.slot_number = j;
+				wrong += !index.deleteEntry(&key, rid);
+			}
+			checkPassFail(wrong, 0)
+			checkPassFail(index.deleteEntry(&key, rid), false)
+			checkPassFail((int)index.lookup(&key, rids), 2)
+			checkPassFail(intCount(&index, 0, numRecords / 2 - 1), numRecords)
+			int low = INT_MIN;
+			int high = -1;
+			index.deleteRange(&low, GTE, &high, LTE);
+			low = numRecords / 2;
+			high = INT_MAX;
+			index.deleteRange(&low, GTE, &high, LTE);
+			checkPassFail(packedEntries(index, leaves), numRecords)
+			checkPassFail((index.freePageNum != 0), true)
+
+			// writers add entries with a few new keys and take half of them out again, while a reader looks up and
+			// scans keys that do not change
+			{
+				const int writers = 4;
+				std::atomic<int> writing(writers);
+				std::atomic<int> errors(0);
+				std::vector<std::thread> threads;
+				for(int t = 0; t < writers; t ++) {
+					threads.push_back(std::thread([&, t]() {
+						RecordId rid;
+						for(int j = 0; j < 2000; j ++) {
+							int k = 3000 + j % 5;
+							rid.page_number = 200000 + k;
+							rid.slot_number = t * 2000 + j;
+							index.insertEntry(&k, rid);
+						}
+						for(int j = 0; j < 2000; j += 2) {
+							int k = 3000 + j % 5;
+							rid.page_number = 200000 + k;
+							rid.slot_number = t * 2000 + j;
+							if(!index.deleteEntry(&k, rid)) errors ++;
+						}
+						writing --;
+					}));
+				}
+				threads.push_back(std::thread([&]() {
+					IndexCursor cursor(&index);
+					std::vector<RecordId> found;
+					RecordId rid;
+					int key = 2990;
+					int high = 3010;
+					while(writing > 0) {
+						if(index.lookup(&key, found) != 2) errors ++;
+						int cnt = 0;
+						int last = key;
+						if(cursor.tryStartScan(&key, GTE, &high, LTE)) {
+							while(cursor.tryScanNext(rid)) {
+								if(keyOf(rid) < last) errors ++;
+								last = keyOf(rid);
+								cnt += (last < 3000 || last > 3004);
+							}
+						}
+						if(cnt != 2 * 16) errors ++;
+					}
+				}));
+				for(std::size_t t = 0; t < threads.size(); t ++) threads[t].join();
+
+				checkPassFail(errors.load(), 0)
+				checkPassFail(intCount(&index, 3000, 3004), 10 + writers * 1000)
+				low = 3000;
+				high = 3004;
+				checkPassFail((int)index.lookup(&low, rids), 2 + writers * 200)
+				index.deleteRange(&low, GTE, &high, LTE);
+				checkPassFail(intCount(&index, 3000, 3004), 0)
+			}
+
+			low = 0;
+			high = 4999;
+			index.deleteRange(&low, GT, &high, LT);
+			checkPassFail(intCount(&index, 0, numRecords), numRecords - 2 * 4998)
+			checkPassFail((int)index.lookup(&high, rids), 2)
+		}
+
+		std::cout << "Reopen index without packed leaves" << std::endl;
+		try
+		{
+			BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+			std::cout << "BadIndexInfoException Test 6 Failed." << std::endl;
+		}
+		catch(const BadIndexInfoException &)
+		{
+			std::cout << "BadIndexInfoException Test 6 Passed." << std::endl;
+		}
+		{
+			BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,i), INTEGER, options);
+			int key = 7000;
+			std::vector<RecordId> rids;
+			checkPassFail((int)index.lookup(&key, rids), 2)
+			checkPassFail(keyOf(rids[1]), key)
+		}
+		File::remove(indexName);
+
+		try
+		{
+			BTreeIndex index(relationNameB, indexName, bufMgr, offsetof(tuple,d), DOUBLE, options);
+			std::cout << "BadIndexInfoException Test 7 Failed." << std::endl;
+		}
+		catch(const BadIndexInfoException &)
+		{
+			std::cout << "BadIndexInfoException Test 7 Passed." << std::endl;
+		}
+	}
+	File::remove(relationNameB);
 }
 
-void intTestsReopen()
+int intCount(BTreeIndex * index, int lowVal, int highVal)
 {
-  std::cout << "reopen existing index " << intIndexName << std::endl;
-//   deleteRelation();
-//   PageFile new_file = PageFile::create(relationName);
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
-  
-	// run some tests
-	checkPassFail(intScan(&index,25,GT,40,LT), 1)
-	checkPassFail(intScan(&index,20,GTE,35,LTE), 2)
-	checkPassFail(intScan(&index,-3,GT,3,LT), 1)
-	checkPassFail(intScan(&index,996,GT,1001,LT), 1)
-	checkPassFail(intScan(&index,0,GT,1,LT), 0)
-	checkPassFail(intScan(&index,300,GT,400,LT), 9) 
-	checkPassFail(intScan(&index,3000,GTE,4000,LT), 100)
+	RecordId rid;
+	int cnt = 0;
+	if(index->tryStartScan(&lowVal, GTE, &highVal, LTE)) {
+		while(index->tryScanNext(rid)) cnt ++;
+		index->endScan();
+	}
+	return cnt;
+}
 
-	// run some additional tests
-	checkPassFail(intScan(&index,-1000,GTE,6000,LT), 600)
-	checkPassFail(intScan(&index,4999,GTE,6000,LT), 100)
-	checkPassFail(intScan(&index,0,GTE,1,LTE), 1)
-	checkPassFail(intScan(&index,0,GTE,4999,LT), 500)
-	checkPassFail(intScan(&index,3000,GTE,6000,LT), 300)
+// number of nodes below nodeId that are less than half full, a leaf alone below the root may be
+int intUnderfull(BTreeIndex * index, PageId nodeId)
+{
+	Page* page;
+	index->bufMgr->readPage(index->file, nodeId, page);
+	NonLeafNodeInt* node = (NonLeafNodeInt*)page;
+	int cnt = 0;
+	for(int i = 0; i <= node->keyArrLength; i ++) {
+		Page* childPage;
+		const PageId childId = node->pageNoArray[i];
+		index->bufMgr->readPage(index->file, childId, childPage);
+		if(node->level != 1) {
+			if(((NonLeafNodeInt*)childPage)->keyArrLength < index->nodeOccupancy / 2) cnt ++;
+		} else if(node->keyArrLength > 0 || nodeId != index->rootPageNum) {
+			if(((LeafNodeInt*)childPage)->keyArrLength < index->leafOccupancy / 2) cnt ++;
+		}
+		index->bufMgr->unPinPage(index->file, childId, false);
+		if(node->level != 1) cnt += intUnderfull(index, childId);
+	}
+	index->bufMgr->unPinPage(index->file, nodeId, false);
+	return cnt;
 }
 
 int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
@@ -798,6 +2601,52 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
   return numResults;
 }
 
+int intScanBatch(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp, std::size_t batchSize)
+{
+  std::cout << "Batch scan of " << batchSize << " for ";
+  if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
+  std::cout << lowVal << "," << highVal;
+  if( highOp == LT ) { std::cout << ")"; } else { std::cout << "]"; }
+  std::cout << std::endl;
+
+	try
+	{
+  	index->startScan(&lowVal, lowOp, &highVal, highOp);
+	}
+	catch(const NoSuchKeyFoundException &)
+	{
+    std::cout << "No Key Found satisfying the scan criteria." << std::endl;
+		return 0;
+	}
+
+	// every returned record has to be in range
+  std::vector<RecordId> rids(batchSize);
+  int numResults = 0;
+	std::size_t cnt;
+	while((cnt = index->scanNextBatch(&rids[0], batchSize)) > 0)
+	{
+		for(std::size_t i = 0; i < cnt; i ++)
+		{
+			Page *curPage;
+			bufMgr->readPage(file1, rids[i].page_number, curPage);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rids[i]).data()));
+			bufMgr->unPinPage(file1, rids[i].page_number, false);
+
+			if((lowOp == GT ? myRec.i <= lowVal : myRec.i < lowVal) || (highOp == LT ? myRec.i >= highVal : myRec.i > highVal))
+			{
+				std::cout << "Record out of range: " << myRec.i << std::endl;
+				index->endScan();
+				return -1;
+			}
+		}
+		numResults += cnt;
+	}
+  index->endScan();
+
+  std::cout << "Number of results: " << numResults << std::endl << std::endl;
+  return numResults;
+}
+
 // -----------------------------------------------------------------------------
 // doubleTests
 // -----------------------------------------------------------------------------
@@ -932,6 +2781,112 @@ void stringTests()
 	checkPassFail(stringScan(&index,3000,GTE,6000,LT), 2000)
 }
 
+void stringTestsSeparators()
+{
+  std::cout << "Separator keys of a B+ Tree index on the string field" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+
+	// keys of the relation only differ in their first 5 characters, split leaves on top of the bulk loaded ones
+	char key[STRINGSIZE + 20];
+	std::vector<RecordId> rids;
+	sprintf(key, "%05d string record", 0);
+	index.lookup(key, rids);
+	const RecordId rid = rids[0];
+	for(int i = 0; i < 30000; i ++) {
+		sprintf(key, "%05d string record", 5000 + i);
+		index.insertEntry(key, rid);
+	}
+
+	// no separator is longer than needed to tell its neighbours apart
+	Page* rootPage;
+	bufMgr->readPage(index.file, index.rootPageNum, rootPage);
+	NonLeafNodeString* root = (NonLeafNodeString*)rootPage;
+	int longest = 0;
+	for(int i = 0; i < root->keyArrLength; i ++) {
+		longest = std::max(longest, (int)strnlen(root->keyArray[i], STRINGSIZE));
+	}
+	bufMgr->unPinPage(index.file, index.rootPageNum, false);
+	checkPassFail((longest > 0 && longest <= 5), true)
+
+	// every key is found through the shortened separators
+	int found = 0;
+	for(int i = 0; i < 35000; i ++) {
+		sprintf(key, "%05d string record", i);
+		found += index.lookup(key, rids);
+	}
+	checkPassFail(found, 35000)
+	checkPassFail(stringScan(&index,3000,GTE,4000,LT), 1000)
+}
+
+void varcharTests()
+{
+  std::cout << "Create a B+ Tree index on the string field with VARCHAR keys" << std::endl;
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), VARCHAR);
+	std::vector<RecordId> rids;
+
+	// whole strings of the relation are keys, not their first STRINGSIZE characters
+	checkPassFail(index.lookup("00042 string record", rids), 1)
+	checkPassFail(index.lookup("00042 stri", rids), 0)
+	checkPassFail(varcharCount(&index, "00300", "00400"), 100)
+	checkPassFail(varcharCount(&index, "", "~"), relationSize)
+
+	// long identifiers with a shared prefix
+	const RecordId rid = rids.empty() ? RecordId() : rids[0];
+	char key[VARCHARSIZE];
+	for(int i = 0; i < 20000; i ++) {
+		sprintf(key, "https://example.com/items/%06d", (i * 7919) % 20000);
+		index.insertEntry(key, rid);
+	}
+	checkPassFail(index.lookup("https://example.com/items/012345", rids), 1)
+	checkPassFail(index.lookup("https://example.com/items/01234", rids), 0)
+	checkPassFail(varcharCount(&index, "https://example.com/items/010000", "https://example.com/items/010999"), 1000)
+
+	index.deleteRange("https://", GTE, "https://~", LT);
+	checkPassFail(varcharCount(&index, "", "~"), relationSize)
+	checkPassFail(index.lookup("00042 string record", rids), 1)
+
+	// a key of VARCHARSIZE characters fits, a longer one is rejected rather than cut
+	char longKey[VARCHARSIZE + 2];
+	memset(longKey, 'x', VARCHARSIZE);
+	longKey[VARCHARSIZE] = '\0';
+	index.insertEntry(longKey, rid);
+	checkPassFail(index.lookup(longKey, rids), 1)
+	longKey[VARCHARSIZE] = 'x';
+	longKey[VARCHARSIZE + 1] = '\0';
+	try
+	{
+		index.insertEntry(longKey, rid);
+		std::cout << "KeyTooLongException Test 1 Failed." << std::endl;
+	}
+	catch(const KeyTooLongException &)
+	{
+		std::cout << "KeyTooLongException Test 1 Passed." << std::endl;
+	}
+	try
+	{
+		index.lookup(longKey, rids);
+		std::cout << "KeyTooLongException Test 2 Failed." << std::endl;
+	}
+	catch(const KeyTooLongException &)
+	{
+		std::cout << "KeyTooLongException Test 2 Passed." << std::endl;
+	}
+	longKey[VARCHARSIZE] = '\0';
+	checkPassFail(index.lookup(longKey, rids), 1)
+	checkPassFail(index.deleteEntry(longKey, rid), true)
+}
+
+int varcharCount(BTreeIndex * index, const char* lowVal, const char* highVal)
+{
+	RecordId rid;
+	int cnt = 0;
+	if(index->tryStartScan(lowVal, GTE, highVal, LTE)) {
+		while(index->tryScanNext(rid)) cnt ++;
+		index->endScan();
+	}
+	return cnt;
+}
+
 void stringTestsSparse()
 {
   std::cout << "Create a B+ Tree index on the string field" << std::endl;
@@ -1132,10 +3087,98 @@ void errorTests()
 	{
 		std::cout << "BadScanrangeException Test 1 Passed." << std::endl;
 	}
-
 	deleteRelation();
 }
 
+void keySearchTests()
+{
+	// every instruction set has to agree with std::lower_bound / std::upper_bound, keys have duplicates
+	std::cout << "Compare scalar, SSE2 and AVX2 key search" << std::endl;
+	std::vector<int> intKeys;
+	std::vector<double> doubleKeys;
+	std::vector<std::int64_t> bigintKeys;
+	std::vector<std::uint32_t> unsignedKeys;
+	std::vector<std::uint64_t> ubigintKeys;
+	// the 64-bit and unsigned keys cross the point where the sign bit flips
+	for(int i = 0; i < 600; i ++) {
+		intKeys.push_back(i / 3);
+		doubleKeys.push_back((double)(i / 3));
+		bigintKeys.push_back((std::int64_t)(i / 3 - 100) << 40);
+		unsignedKeys.push_back((std::uint32_t)(i / 3) * 0x01400000u);
+		ubigintKeys.push_back((std::uint64_t)(i / 3) << 56);
+	}
+
+	const KeySearchMode defaultMode = getKeySearchMode();
+	const KeySearchMode modes[] = {SEARCH_SCALAR, SEARCH_SSE2, SEARCH_AVX2};
+	for(int m = 0; m < 3; m ++) {
+		setKeySearchMode(modes[m]);
+		int wrong = 0;
+		for(int n = 0; n <= 600; n += 7) {
+			for(int key = -1; key <= 201; key ++) {
+				const double dkey = key + 0.5 * (key % 2);
+				wrong += lowerBound(&intKeys[0], n, key) != std::lower_bound(intKeys.begin(), intKeys.begin() + n, key) - intKeys.begin();
+				wrong += upperBound(&intKeys[0], n, key) != std::upper_bound(intKeys.begin(), intKeys.begin() + n, key) - intKeys.begin();
+				wrong += lowerBound(&doubleKeys[0], n, dkey) != std::lower_bound(doubleKeys.begin(), doubleKeys.begin() + n, dkey) - doubleKeys.begin();
+				wrong += upperBound(&doubleKeys[0], n, dkey) != std::upper_bound(doubleKeys.begin(), doubleKeys.begin() + n, dkey) - doubleKeys.begin();
+				const std::int64_t bkey = (std::int64_t)(key - 100) << 40;
+				const std::uint32_t ukey = (std::uint32_t)key * 0x01400000u;
+				const std::uint64_t ubkey = (std::uint64_t)key << 56;
+				wrong += lowerBound(&bigintKeys[0], n, bkey) != std::lower_bound(bigintKeys.begin(), bigintKeys.begin() + n, bkey) - bigintKeys.begin();
+				wrong += upperBound(&bigintKeys[0], n, bkey) != std::upper_bound(bigintKeys.begin(), bigintKeys.begin() + n, bkey) - bigintKeys.begin();
+				wrong += lowerBound(&unsignedKeys[0], n, ukey) != std::lower_bound(unsignedKeys.begin(), unsignedKeys.begin() + n, ukey) - unsignedKeys.begin();
+				wrong += upperBound(&unsignedKeys[0], n, ukey) != std::upper_bound(unsignedKeys.begin(), unsignedKeys.begin() + n, ukey) - unsignedKeys.begin();
+				wrong += lowerBound(&ubigintKeys[0], n, ubkey) != std::lower_bound(ubigintKeys.begin(), ubigintKeys.begin() + n, ubkey) - ubigintKeys.begin();
+				wrong += upperBound(&ubigintKeys[0], n, ubkey) != std::upper_bound(ubigintKeys.begin(), ubigintKeys.begin() + n, ubkey) - ubigintKeys.begin();
+			}
+		}
+		checkPassFail(wrong, 0)
+	}
+	setKeySearchMode(defaultMode);
+
+	// the word compare of character keys has to order like memcmp, bytes above 0x7f included
+	std::cout << "Compare character key compare with memcmp" << std::endl;
+	int wrong = 0;
+	srand(7);
+	for(int t = 0; t < 20000; t ++) {
+		CharKey<COMPOSITESIZE> k1, k2;
+		for(int i = 0; i < COMPOSITESIZE; i ++) {
+			k1.data[i] = rand() % 4 * 0x50;
+			k2.data[i] = (t % 3 == 0) ? k1.data[i] : rand() % 4 * 0x50;
+		}
+		k2.data[t % COMPOSITESIZE] = rand() % 4 * 0x50;
+		const int expect = memcmp(k1.data, k2.data, COMPOSITESIZE);
+		const int got = compareKeyBytes<COMPOSITESIZE>(k1.data, k2.data);
+		wrong += (expect < 0) != (got < 0) || (expect == 0) != (got == 0);
+		wrong += (k1 < k2) != (expect < 0);
+		wrong += (StringKey&)k1 < (StringKey&)k2 ? memcmp(k1.data, k2.data, STRINGSIZE) >= 0
+		                                         : memcmp(k1.data, k2.data, STRINGSIZE) < 0;
+	}
+	checkPassFail(wrong, 0)
+}
+
+void badIndexInfoTests()
+{
+	// index file built by errorTests is still there
+	std::cout << "Reopen index with a different attribute type" << std::endl;
+	try
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), DOUBLE);
+		std::cout << "BadIndexInfoException Test 1 Failed." << std::endl;
+	}
+	catch(const BadIndexInfoException &)
+	{
+		std::cout << "BadIndexInfoException Test 1 Passed." << std::endl;
+	}
+
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &)
+	{
+	}
+}
+
 void deleteRelation()
 {
 	if(file1)
@@ -0,0 +1,798 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "packed.h"
+#include "varint.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace badgerdb
+{
+
+/**
+ * Number of bytes of the keys and record ids of a packed leaf.
+ */
+static const int PACKEDLEAFSIZE = sizeof(PackedLeaf::data);
+
+/**
+ * Number of bits a key difference takes.
+ */
+static int bitWidth(std::uint32_t val) {
+	int bits = 0;
+	while(val != 0) {
+		val >>= 1;
+		bits ++;
+	}
+	return bits;
+}
+
+/**
+ * Difference of a key to the base of its leaf. The keys of a leaf are not below the base, so the difference of any
+ * two ints fits into 32 bits.
+ */
+static std::uint32_t keyDelta(const int key, const int base) {
+	return (std::uint32_t)key - (std::uint32_t)base;
+}
+
+/**
+ * Zigzag encoded difference of the record id of entry i to the one before.
+ */
+static std::uint64_t ridDelta(const std::uint64_t* vals, const std::size_t i) {
+	return zigzag((std::int64_t)(vals[i] - (i == 0 ? 0 : vals[i - 1])));
+}
+
+/**
+ * Number of bytes of n entries whose key differences take bits bits each and whose record ids take ridBytes bytes.
+ */
+static std::uint64_t leafBytes(const std::uint64_t n, const int bits, const std::uint64_t ridBytes) {
+	return (n * bits + 7) / 8 + ridBytes;
+}
+
+/**
+ * Number of leading entries of sorted keys that fit into capacity bytes of a packed leaf, at least one.
+ */
+static std::size_t fitEntries(const int* keys, const std::uint64_t* vals, const std::size_t n, const int capacity) {
+	int bits = 0;
+	std::uint64_t ridBytes = 0;
+	std::size_t i = 0;
+	for(; i < n; i ++) {
+		const int newBits = std::max(bits, bitWidth(keyDelta(keys[i], keys[0])));
+		const std::uint64_t newRidBytes = ridBytes + varintSize(ridDelta(vals, i));
+		if(i > 0 && leafBytes(i + 1, newBits, newRidBytes) > (std::uint64_t)capacity) break;
+		bits = newBits;
+		ridBytes = newRidBytes;
+	}
+	return i;
+}
+
+/**
+ * Encode n sorted entries into a packed leaf, see PackedLeaf. They have to fit, see fitEntries().
+ */
+static void packLeaf(const int* keys, const std::uint64_t* vals, const std::size_t n, PackedLeaf* leaf) {
+	memset(leaf, 0, sizeof(PackedLeaf));
+	leaf->count = n;
+	if(n == 0) {
+		return;
+	}
+	leaf->base = keys[0];
+	leaf->bits = bitWidth(keyDelta(keys[n - 1], keys[0]));
+	for(std::size_t i = 0; i < n; i ++) {
+		const std::uint64_t bit = (std::uint64_t)i * leaf->bits;
+		std::uint64_t delta = (std::uint64_t)keyDelta(keys[i], keys[0]) << (bit & 7);
+		for(unsigned char* out = leaf->data + (bit >> 3); delta != 0; out ++) {
+			*out |= (unsigned char)delta;
+			delta >>= 8;
+		}
+	}
+	unsigned char* out = leaf->data + leafBytes(n, leaf->bits, 0);
+	for(std::size_t i = 0; i < n; i ++) {
+		out += putVarint(out, ridDelta(vals, i));
+	}
+}
+
+/**
+ * Decode the entries of a packed leaf. A leaf read next to a writer may hold anything, so the count and the width
+ * are kept within the leaf and decoding stops at its end; the caller throws the entries away when it validates.
+ */
+static void unpackLeaf(const PackedLeaf* leaf, std::vector<int> & keys, std::vector<std::uint64_t> & vals) {
+	keys.clear();
+	vals.clear();
+	const int bits = std::min(leaf->bits, (std::uint32_t)32);
+	const std::size_t n = std::min(leaf->count, (std::uint32_t)PACKEDLEAFSIZE);
+	const std::uint64_t keyBytes = leafBytes(n, bits, 0);
+	if(keyBytes >= (std::uint64_t)PACKEDLEAFSIZE) {
+		return;
+	}
+
+	const std::uint64_t mask = ((std::uint64_t)1 << bits) - 1;
+	for(std::size_t i = 0; i < n; i ++) {
+		const std::uint64_t bit = (std::uint64_t)i * bits;
+		const unsigned char* in = leaf->data + (bit >> 3);
+		std::uint64_t window = 0;
+		for(std::uint64_t b = 0; b * 8 < (bit & 7) + bits; b ++) {
+			window |= (std::uint64_t)in[b] << (8 * b);
+		}
+		keys.push_back((int)((std::uint32_t)leaf->base + (std::uint32_t)((window >> (bit & 7)) & mask)));
+	}
+
+	const unsigned char* in = leaf->data + keyBytes;
+	const unsigned char* end = leaf->data + PACKEDLEAFSIZE;
+	std::uint64_t val = 0;
+	for(std::size_t i = 0; i < n && in < end; i ++) {
+		val += unzigzag(getVarint(in, end));
+		vals.push_back(val);
+	}
+	keys.resize(vals.size());
+}
+
+/**
+ * Position of the entry <key, val> in the entries of a packed leaf, the number of entries if it is not there.
+ */
+static std::size_t findRid(const std::vector<int> & keys, const std::vector<std::uint64_t> & vals, const int key,
+                           const std::uint64_t val) {
+	std::size_t i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+	while(i < keys.size() && keys[i] == key && vals[i] != val) {
+		i ++;
+	}
+	return (i < keys.size() && keys[i] == key) ? i : keys.size();
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::PackedCore -- Constructor
+// -----------------------------------------------------------------------------
+
+PackedCore::PackedCore(BTreeIndex* index) : BTreeCore<IntKeyTraits>(index) {
+	static_assert(sizeof(PackedLeaf) <= Page::SIZE, "packed leaf does not fit into a page");
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::buildIndex
+// -----------------------------------------------------------------------------
+
+/*
+The <key, rid> pairs of the relation are sorted as for any index and cut into packed leaves in key order, each one
+filled up to the fill factor. The directory entry of every leaf is handed to a second sorter, which the bulk loader
+streams; directory entries with equal keys stay in the order of their leaves, whose page numbers grow.
+*/
+
+void PackedCore::buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions) {
+	BTreeIndex* index = this->index;
+	ExternalSorter<RIDKeyPair<int> > sorter(index->bufMgr, index->file->filename() + ".sort",
+	                                        buildOptions.sortMemPages);
+	this->sortRelation(relationName, buildOptions, sorter);
+
+	ExternalSorter<RIDKeyPair<int> > heads(index->bufMgr, index->file->filename() + ".keys",
+	                                       buildOptions.sortMemPages);
+	const int capacity = (int)(std::min(1.0, std::max(0.0, buildOptions.fillFactor)) * PACKEDLEAFSIZE);
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+	RIDKeyPair<int> entry;
+	bool more = sorter.next(entry);
+	while(true) {
+		// every record id takes a byte at least, no leaf holds more entries than it has bytes
+		while(more && keys.size() <= (std::size_t)PACKEDLEAFSIZE) {
+			keys.push_back(entry.key);
+			vals.push_back(ridValue(entry.rid));
+			more = sorter.next(entry);
+		}
+
+		// the last leaf, empty if the relation is, takes every key above the ones of the index
+		const std::size_t n = fitEntries(keys.data(), vals.data(), keys.size(), capacity);
+		const bool last = !more && n == keys.size();
+		const RecordId leafRid = {newLeaf(keys.data(), vals.data(), n), 0};
+		RIDKeyPair<int> dirEntry;
+		dirEntry.set(leafRid, last ? INT_MAX : keys[n - 1]);
+		heads.add(dirEntry);
+		if(last) {
+			break;
+		}
+		keys.erase(keys.begin(), keys.begin() + n);
+		vals.erase(vals.begin(), vals.begin() + n);
+	}
+
+	heads.finish();
+	this->bulkLoad(heads, buildOptions.fillFactor);
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::findEntry / stepEntry / entriesExclusive / latchLeaf
+// -----------------------------------------------------------------------------
+
+bool PackedCore::findEntry(const int key, const bool after, const std::uint64_t treeVersion, PageId & leafId,
+                           std::uint64_t & version, int & pos, int & dirKey, PageId & pageNo, bool & found) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	found = false;
+	version = 0;
+	if(!this->findLeafOptimistic(key, !after, treeVersion, leafId, version)) return false;
+	if(leafId == 0) return this->index->latches.tree().validate(treeVersion);
+
+	Page* page;
+	bufMgr->readPage(file, leafId, page);
+	LeafNode* leaf = (LeafNode*)page;
+	const int len = this->lengthOf(leaf);
+	const int* keys = this->keysOf(leaf);
+	pos = after ? IntKeyTraits::upperBound(keys, len, key) : IntKeyTraits::lowerBound(keys, len, key);
+	found = (pos < len);
+	if(found) {
+		dirKey = keys[pos];
+		pageNo = leaf->ridArray[pos].page_number;
+	}
+	bufMgr->unPinPage(file, leafId, false);
+	if(!this->validate(leafId, version, treeVersion)) return false;
+	if(found) return true;
+
+	// all entries of the leaf are before key, the entry is the first one of the leaves on the right
+	pos = len - 1;
+	return stepEntry(leafId, version, pos, false, treeVersion, dirKey, pageNo, found);
+}
+
+bool PackedCore::stepEntry(PageId & leafId, std::uint64_t & version, int & pos, const bool back,
+                           const std::uint64_t treeVersion, int & dirKey, PageId & pageNo, bool & found) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	LatchTable & latches = this->index->latches;
+
+	found = false;
+	while(leafId != 0) {
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int len = this->lengthOf(leaf);
+		const int next = back ? std::min(pos, len) - 1 : pos + 1;
+		found = (next >= 0 && next < len);
+		if(found) {
+			dirKey = this->keysOf(leaf)[next];
+			pageNo = leaf->ridArray[next].page_number;
+		}
+		const PageId sibId = back ? leaf->leftSibPageNo : leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, leafId, false);
+		if(!this->validate(leafId, version, treeVersion)) return false;
+		if(found) {
+			pos = next;
+			return true;
+		}
+
+		// past the end of the leaf, a step from there tries the same end again
+		pos = back ? 0 : len - 1;
+		if(sibId == 0) return true;
+		const std::uint64_t sibVersion = latches.node(sibId).readLock();
+		if(!latches.node(leafId).validate(version)) return false;
+		leafId = sibId;
+		version = sibVersion;
+		pos = back ? INT_MAX : -1;
+	}
+	return true;
+}
+
+void PackedCore::entriesExclusive(const int lowKey, const int highKey, std::vector<int> & dirKeys,
+                                  std::vector<PageId> & pages) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	PageId leafId = this->findLeaf(lowKey, true);
+	int pos = -1;
+	bool past = false;
+	while(leafId != 0 && !past) {
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int* keys = this->keysOf(leaf);
+		const int len = leaf->keyArrLength;
+		if(pos < 0) {
+			pos = IntKeyTraits::lowerBound(keys, len, lowKey);
+		}
+		for(; pos < len && !past; pos ++) {
+			dirKeys.push_back(keys[pos]);
+			pages.push_back(leaf->ridArray[pos].page_number);
+			past = keys[pos] > highKey;
+		}
+		const PageId rightId = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, leafId, false);
+		leafId = rightId;
+		pos = 0;
+	}
+}
+
+bool PackedCore::latchLeaf(const PageId leafId, const std::uint64_t version, const std::uint64_t treeVersion) {
+	LatchTable & latches = this->index->latches;
+	if(!latches.node(leafId).tryUpgrade(version)) {
+		return false;
+	}
+	if(!latches.tree().validate(treeVersion)) {
+		latches.node(leafId).unlock();
+		return false;
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::readLeaf / writeLeaf / newLeaf
+// -----------------------------------------------------------------------------
+
+void PackedCore::readLeaf(const PageId pageNo, std::vector<int> & keys, std::vector<std::uint64_t> & vals) {
+	Page* page;
+	this->index->bufMgr->readPage(this->index->file, pageNo, page);
+	unpackLeaf((PackedLeaf*)page, keys, vals);
+	this->index->bufMgr->unPinPage(this->index->file, pageNo, false);
+}
+
+bool PackedCore::writeLeaf(const PageId pageNo, const int* keys, const std::uint64_t* vals, const std::size_t n) {
+	if(fitEntries(keys, vals, n, PACKEDLEAFSIZE) < n) {
+		return false;
+	}
+	Page* page;
+	this->index->bufMgr->readPage(this->index->file, pageNo, page);
+	packLeaf(keys, vals, n, (PackedLeaf*)page);
+	this->index->bufMgr->unPinPage(this->index->file, pageNo, true);
+	return true;
+}
+
+PageId PackedCore::newLeaf(const int* keys, const std::uint64_t* vals, const std::size_t n) {
+	PageId pageNo;
+	Page* page;
+	this->allocNode(pageNo, page);
+	packLeaf(keys, vals, n, (PackedLeaf*)page);
+	this->index->bufMgr->unPinPage(this->index->file, pageNo, true);
+	return pageNo;
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::insertEntry / splitLeaf
+// -----------------------------------------------------------------------------
+
+/*
+An entry goes to the leaf of the first directory entry not below its key, after the entries with equal keys, so
+the keys of every leaf stay within the directory keys around it. It is added holding only the latch of the
+directory leaf while the packed leaf has room for it, a leaf that overflows is split under the tree latch.
+*/
+
+void PackedCore::insertEntry(const void* keyParm, const RecordId rid, const void* /*payload*/) {
+	LatchTable & latches = this->index->latches;
+	int key;
+	IntKeyTraits::load(keyParm, key);
+	const std::uint64_t val = ridValue(rid);
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t version;
+		int pos;
+		int dirKey;
+		PageId pageNo;
+		bool found;
+		if(!findEntry(key, false, treeVersion, leafId, version, pos, dirKey, pageNo, found)) continue;
+		if(!found) break;
+		if(!latchLeaf(leafId, version, treeVersion)) continue;
+		bool fits;
+		try {
+			readLeaf(pageNo, keys, vals);
+			const std::size_t at = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+			keys.insert(keys.begin() + at, key);
+			vals.insert(vals.begin() + at, val);
+			fits = writeLeaf(pageNo, keys.data(), vals.data(), keys.size());
+		} catch(...) {
+			latches.node(leafId).unlock();
+			throw;
+		}
+		latches.node(leafId).unlock();
+		if(fits) return;
+		break;
+	}
+
+	// the packed leaf is full, or the index has none at all
+	TreeLock lock(latches);
+	std::vector<int> dirKeys;
+	std::vector<PageId> pages;
+	entriesExclusive(key, key, dirKeys, pages);
+	if(pages.empty()) {
+		const RecordId leafRid = {newLeaf(&key, &val, 1), 0};
+		this->insertExclusive(INT_MAX, leafRid, NULL);
+		return;
+	}
+	readLeaf(pages[0], keys, vals);
+	const std::size_t at = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+	keys.insert(keys.begin() + at, key);
+	vals.insert(vals.begin() + at, val);
+	if(!writeLeaf(pages[0], keys.data(), vals.data(), keys.size())) {
+		splitLeaf(dirKeys[0], pages[0], keys, vals);
+	}
+}
+
+/*
+A leaf that overflows is cut into runs of at most half a leaf each, so that every run has room left. The leaf keeps
+the first run whose largest key is its directory key, or the last run. The runs before it go to new leaves with
+their largest key as directory key, the runs after it hold nothing but the directory key and go to new leaves with
+it. Directory entries are inserted after the ones with equal keys, so the new entries fall into place before and
+after the entry of the leaf in the order of the runs.
+*/
+
+void PackedCore::splitLeaf(const int dirKey, const PageId pageNo, const std::vector<int> & keys,
+                           const std::vector<std::uint64_t> & vals) {
+	std::vector<std::size_t> starts;
+	for(std::size_t start = 0; start < keys.size(); ) {
+		starts.push_back(start);
+		start += fitEntries(keys.data() + start, vals.data() + start, keys.size() - start, PACKEDLEAFSIZE / 2);
+	}
+	starts.push_back(keys.size());
+	const std::size_t runs = starts.size() - 1;
+	std::size_t keep = 0;
+	while(keep + 1 < runs && keys[starts[keep + 1] - 1] < dirKey) {
+		keep ++;
+	}
+
+	writeLeaf(pageNo, keys.data() + starts[keep], vals.data() + starts[keep], starts[keep + 1] - starts[keep]);
+	for(std::size_t i = 0; i < runs; i ++) {
+		if(i == keep) continue;
+		const std::size_t n = starts[i + 1] - starts[i];
+		const RecordId leafRid = {newLeaf(keys.data() + starts[i], vals.data() + starts[i], n), 0};
+		this->insertExclusive(i < keep ? keys[starts[i + 1] - 1] : dirKey, leafRid, NULL);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::deleteEntry
+// -----------------------------------------------------------------------------
+
+/*
+An entry is removed holding only the latch of the directory leaf, a packed leaf never takes more bytes with an
+entry less. Removing the last entry of a leaf removes the leaf and its directory entry under the tree latch, except
+for the leaf of the last directory entry, which stays to take the largest keys.
+*/
+
+bool PackedCore::deleteEntry(const void* keyParm, const RecordId rid) {
+	LatchTable & latches = this->index->latches;
+	int key;
+	IntKeyTraits::load(keyParm, key);
+	const std::uint64_t val = ridValue(rid);
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t version;
+		int pos;
+		int dirKey;
+		PageId pageNo;
+		bool found;
+		bool valid = findEntry(key, false, treeVersion, leafId, version, pos, dirKey, pageNo, found);
+
+		// entries with key may be in the leaves of all directory entries up to the first one above key
+		std::size_t at = 0;
+		bool present = false;
+		while(valid && found) {
+			readLeaf(pageNo, keys, vals);
+			valid = this->validate(leafId, version, treeVersion);
+			if(!valid) break;
+			at = findRid(keys, vals, key, val);
+			present = (at < keys.size());
+			if(present || dirKey > key) break;
+			valid = stepEntry(leafId, version, pos, false, treeVersion, dirKey, pageNo, found);
+		}
+		if(!valid) continue;
+		if(!present) return false;
+		if(keys.size() == 1) break;
+		if(!latchLeaf(leafId, version, treeVersion)) continue;
+		try {
+			keys.erase(keys.begin() + at);
+			vals.erase(vals.begin() + at);
+			writeLeaf(pageNo, keys.data(), vals.data(), keys.size());
+		} catch(...) {
+			latches.node(leafId).unlock();
+			throw;
+		}
+		latches.node(leafId).unlock();
+		return true;
+	}
+
+	// last entry of its leaf
+	TreeLock lock(latches);
+	std::vector<int> dirKeys;
+	std::vector<PageId> pages;
+	entriesExclusive(key, key, dirKeys, pages);
+	for(std::size_t i = 0; i < pages.size(); i ++) {
+		readLeaf(pages[i], keys, vals);
+		const std::size_t at = findRid(keys, vals, key, val);
+		if(at == keys.size()) continue;
+		keys.erase(keys.begin() + at);
+		vals.erase(vals.begin() + at);
+		if(keys.empty() && dirKeys[i] != INT_MAX) {
+			const RecordId leafRid = {pages[i], 0};
+			this->deleteExclusive(dirKeys[i], leafRid);
+			this->freeNode(pages[i]);
+		} else {
+			writeLeaf(pages[i], keys.data(), vals.data(), keys.size());
+		}
+		return true;
+	}
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::deleteRangeExclusive
+// -----------------------------------------------------------------------------
+
+void PackedCore::deleteRangeExclusive(const int & lowKey, const Operator lowOp, const int & highKey,
+                                      const Operator highOp) {
+	std::vector<int> dirKeys;
+	std::vector<PageId> pages;
+	entriesExclusive(lowKey, highKey, dirKeys, pages);
+
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+	for(std::size_t i = 0; i < pages.size(); i ++) {
+		readLeaf(pages[i], keys, vals);
+		std::size_t kept = 0;
+		for(std::size_t j = 0; j < keys.size(); j ++) {
+			const bool below = (lowOp == GTE) ? keys[j] < lowKey : keys[j] <= lowKey;
+			const bool above = (highOp == LTE) ? keys[j] > highKey : keys[j] >= highKey;
+			if(below || above) {
+				keys[kept] = keys[j];
+				vals[kept] = vals[j];
+				kept ++;
+			}
+		}
+		if(kept == keys.size()) continue;
+		if(kept == 0 && dirKeys[i] != INT_MAX) {
+			const RecordId leafRid = {pages[i], 0};
+			this->deleteExclusive(dirKeys[i], leafRid);
+			this->freeNode(pages[i]);
+		} else {
+			writeLeaf(pages[i], keys.data(), vals.data(), kept);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::startScan
+// -----------------------------------------------------------------------------
+
+/*
+A scan decodes one packed leaf at a time and keeps the entries of it that are in its range, in scan order. The
+cursor validates the directory leaf of the entry of the packed leaf before it returns an entry, and if it changed
+finds its place again from the last key it returned like the BTreeCore cursor, skipping as many entries with that
+key as it returned in a row. A forward scan ends at the first leaf whose smallest key is above the range, a
+reverse scan at the first one whose largest key is below it.
+*/
+
+bool PackedCore::startScan(IndexCursor & cursor, const void* lowValParm, const Operator lowOpParm,
+                           const void* highValParm, const Operator highOpParm, const bool reverse) {
+	// check op
+	if((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+		throw BadOpcodesException();
+	}
+
+	// if lowVal > highVal throw exception
+	int lowKey;
+	int highKey;
+	IntKeyTraits::load(lowValParm, lowKey);
+	IntKeyTraits::load(highValParm, highKey);
+	if(highKey < lowKey) throw BadScanrangeException();
+
+	// end scan that is still running
+	if(cursor.scanExecuting) {
+		cursor.endScan();
+	}
+	*(int*)cursor.highVal = highKey;
+	*(int*)cursor.lowVal = lowKey;
+	cursor.lowOp = lowOpParm;
+	cursor.highOp = highOpParm;
+	cursor.reverse = reverse;
+	cursor.lastKeyCount = 0;
+	cursor.skipCount = 0;
+	cursor.scanExecuting = true;
+
+	bool more = findPlace(cursor);
+	while(more && cursor.postingRids.empty()) {
+		more = nextLeaf(cursor);
+	}
+	if(!more) {
+		cursor.endScan();
+	}
+	return more;
+}
+
+bool PackedCore::findPlace(IndexCursor & cursor) {
+	LatchTable & latches = this->index->latches;
+	const int key = (cursor.lastKeyCount > 0) ? lastKeyOf(cursor) : (cursor.reverse ? highValOf(cursor)
+	                                                                               : lowValOf(cursor));
+	cursor.skipCount = cursor.lastKeyCount;
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t version;
+		int pos;
+		int dirKey;
+		PageId pageNo;
+		bool found;
+
+		// a reverse scan starts at the last leaf that may hold key, the one of the first entry above key
+		if(!findEntry(key, cursor.reverse, treeVersion, leafId, version, pos, dirKey, pageNo, found)) continue;
+		if(cursor.reverse && !found) {
+			pos ++;
+			if(!stepEntry(leafId, version, pos, true, treeVersion, dirKey, pageNo, found)) continue;
+		}
+
+		cursor.currentPageNum = leafId;
+		cursor.nextEntry = pos;
+		cursor.leafVersion = version;
+		cursor.treeVersion = treeVersion;
+		cursor.postingRids.clear();
+		cursor.packedKeys.clear();
+		cursor.postingPos = 0;
+		if(!found) {
+			return false;
+		}
+		bool past;
+		if(!loadLeaf(cursor, pageNo, past)) continue;
+		return !past;
+	}
+}
+
+bool PackedCore::nextLeaf(IndexCursor & cursor) {
+	PageId leafId = cursor.currentPageNum;
+	std::uint64_t version = cursor.leafVersion;
+	int pos = cursor.nextEntry;
+	int dirKey;
+	PageId pageNo;
+	bool found;
+	if(!stepEntry(leafId, version, pos, cursor.reverse, cursor.treeVersion, dirKey, pageNo, found)) {
+		return findPlace(cursor);
+	}
+	cursor.postingRids.clear();
+	cursor.packedKeys.clear();
+	cursor.postingPos = 0;
+	if(!found) {
+		return false;
+	}
+
+	// a leaf beyond the range is not moved to, a scan that is asked for more later reads it again
+	const PageId lastLeafId = cursor.currentPageNum;
+	const std::uint64_t lastVersion = cursor.leafVersion;
+	const int lastPos = cursor.nextEntry;
+	cursor.currentPageNum = leafId;
+	cursor.leafVersion = version;
+	cursor.nextEntry = pos;
+	bool past;
+	if(!loadLeaf(cursor, pageNo, past)) {
+		return findPlace(cursor);
+	}
+	if(past) {
+		cursor.currentPageNum = lastLeafId;
+		cursor.leafVersion = lastVersion;
+		cursor.nextEntry = lastPos;
+	}
+	return !past;
+}
+
+bool PackedCore::loadLeaf(IndexCursor & cursor, const PageId pageNo, bool & past) {
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+	readLeaf(pageNo, keys, vals);
+	if(!this->cursorValid(cursor)) return false;
+
+	cursor.postingRids.clear();
+	cursor.packedKeys.clear();
+	cursor.postingPos = 0;
+	const int low = lowValOf(cursor);
+	const int high = highValOf(cursor);
+	const std::size_t n = keys.size();
+	past = false;
+	if(n == 0) {
+		return true;
+	}
+	if(cursor.reverse) {
+		past = (cursor.lowOp == GTE) ? keys[n - 1] < low : keys[n - 1] <= low;
+	} else {
+		past = (cursor.highOp == LTE) ? keys[0] > high : keys[0] >= high;
+	}
+
+	for(std::size_t i = 0; i < n && !past; i ++) {
+		const std::size_t j = cursor.reverse ? n - 1 - i : i;
+		const int key = keys[j];
+		const bool inRange = ((cursor.lowOp == GTE) ? key >= low : key > low)
+		                     && ((cursor.highOp == LTE) ? key <= high : key < high);
+		// entries before the last key returned were returned already or were inserted behind the cursor
+		const bool behind = cursor.lastKeyCount > 0
+		                    && (cursor.reverse ? lastKeyOf(cursor) < key : key < lastKeyOf(cursor));
+		if(!inRange || behind || this->skipEqual(cursor, key)) continue;
+		cursor.postingRids.push_back(ridOf(vals[j]));
+		cursor.packedKeys.push_back(key);
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::scanNext / scanNextBatch
+// -----------------------------------------------------------------------------
+
+bool PackedCore::scanNext(IndexCursor & cursor, RecordId& outRid, void* /*outPayload*/) {
+	return nextRid(cursor, outRid);
+}
+
+std::size_t PackedCore::scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids,
+                                      void* /*outPayloads*/) {
+	std::size_t cnt = 0;
+	while(cnt < maxRids && nextRid(cursor, outRids[cnt])) {
+		cnt ++;
+	}
+	return cnt;
+}
+
+bool PackedCore::nextRid(IndexCursor & cursor, RecordId & outRid) {
+	if(!this->cursorValid(cursor) && !findPlace(cursor)) {
+		return false;
+	}
+	while(cursor.postingPos >= cursor.postingRids.size()) {
+		if(!nextLeaf(cursor)) {
+			return false;
+		}
+	}
+	const std::size_t pos = cursor.postingPos ++;
+	outRid = cursor.postingRids[pos];
+	this->noteReturned(cursor, cursor.packedKeys[pos], 1);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PackedCore::lookup / lookupBatch
+// -----------------------------------------------------------------------------
+
+std::size_t PackedCore::lookup(const void* keyParm, std::vector<RecordId> & outRids) {
+	LatchTable & latches = this->index->latches;
+	int key;
+	IntKeyTraits::load(keyParm, key);
+	std::vector<int> keys;
+	std::vector<std::uint64_t> vals;
+
+	while(true) {
+		outRids.clear();
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t version;
+		int pos;
+		int dirKey;
+		PageId pageNo;
+		bool found;
+		bool valid = findEntry(key, false, treeVersion, leafId, version, pos, dirKey, pageNo, found);
+
+		// equal keys may run on over the leaves of the directory entries up to the first one above key
+		while(valid && found) {
+			readLeaf(pageNo, keys, vals);
+			valid = this->validate(leafId, version, treeVersion);
+			if(!valid) break;
+			for(std::size_t i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+			    i < keys.size() && keys[i] == key; i ++) {
+				outRids.push_back(ridOf(vals[i]));
+			}
+			if(dirKey > key) break;
+			valid = stepEntry(leafId, version, pos, false, treeVersion, dirKey, pageNo, found);
+		}
+		if(valid) {
+			return outRids.size();
+		}
+	}
+}
+
+std::size_t PackedCore::lookupBatch(const void* keys, const std::size_t n,
+                                    std::vector<std::vector<RecordId> > & results) {
+	results.resize(n);
+	std::size_t total = 0;
+	for(std::size_t i = 0; i < n; i ++) {
+		total += lookup((const char*)keys + i * sizeof(int), results[i]);
+	}
+	return total;
+}
+
+}
@@ -0,0 +1,170 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <vector>
+#include "btree_core.h"
+
+namespace badgerdb
+{
+
+/*
+An index with packed leaves keeps its entries in PackedLeaf pages and a B+ tree over them, the directory, with one
+entry per packed leaf: the largest key of the leaf and the record id {page number of the leaf, 0}. The last leaf
+has the largest int as directory key instead, so every key has a leaf to go to. The keys of a packed leaf are not
+below the directory key of the leaf before and not above its own, equal keys may run over several leaves. The
+directory is an ordinary BTreeCore tree, so it is built, searched and rebalanced by the BTreeCore code.
+
+A packed leaf is read and written as a whole. Writers change it holding the latch of the directory leaf of its
+entry, or the tree latch when the directory changes; readers validate that latch after decoding it.
+*/
+
+/**
+ * @brief B+ tree operations for an INTEGER index with packed leaves. Scans walk the directory themselves: the
+ * current page, entry and versions of the cursor are those of the directory leaf, the entries of the current packed
+ * leaf are kept in IndexCursor::postingRids and IndexCursor::packedKeys.
+ */
+class PackedCore : public BTreeCore<IntKeyTraits> {
+
+ public:
+
+  /**
+   * Constructor of PackedCore class.
+   * @param index	Index the tree belongs to
+   */
+	PackedCore(BTreeIndex* index);
+
+  /**
+   * Sort the <key, rid> pairs of the base relation, fill packed leaves with them as far as the fill factor goes
+   * and bulk load the directory.
+   */
+	void buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions);
+
+  /**
+   * Add the entry to its packed leaf, splitting the leaf if it does not fit. The payload is ignored.
+   */
+	void insertEntry(const void* key, const RecordId rid, const void* payload);
+
+  /**
+   * Remove the entry from its packed leaf, and the leaf once it is empty.
+   */
+	bool deleteEntry(const void* key, const RecordId rid);
+
+	bool startScan(IndexCursor & cursor, const void* lowVal, const Operator lowOp,
+	               const void* highVal, const Operator highOp, const bool reverse);
+
+  /**
+   * Return the next entry of the current packed leaf, moving on to the next leaf when it is used up. The
+   * payload is not returned.
+   */
+	bool scanNext(IndexCursor & cursor, RecordId& outRid, void* outPayload);
+
+	std::size_t scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids, void* outPayloads);
+
+	std::size_t lookup(const void* key, std::vector<RecordId> & outRids);
+
+	std::size_t lookupBatch(const void* keys, const std::size_t n, std::vector<std::vector<RecordId> > & results);
+
+ protected:
+
+  /**
+   * Remove the entries in the range from their packed leaves, and the leaves left empty from the directory.
+   */
+	void deleteRangeExclusive(const int & lowKey, const Operator lowOp, const int & highKey, const Operator highOp);
+
+ private:
+
+  /**
+   * Find the first directory entry not below key, or above key if after is set, without latching, see
+   * BTreeCore::findLeafOptimistic().
+   * @param treeVersion	Version of the tree latch taken by the caller
+   * @param leafId				Set to the directory leaf holding the entry
+   * @param version				Set to the version of the latch of the leaf when the entry was read
+   * @param pos						Set to the position of the entry in the leaf
+   * @param dirKey				Set to the key of the entry
+   * @param pageNo				Set to the packed leaf of the entry
+   * @param found					Set to false if there is no such entry, the position is past the last entry then
+   * @return	False if a node changed on the way, the caller starts over
+   */
+	bool findEntry(const int key, const bool after, const std::uint64_t treeVersion, PageId & leafId,
+	               std::uint64_t & version, int & pos, int & dirKey, PageId & pageNo, bool & found);
+
+  /**
+   * Move a position found by findEntry() to the next directory entry, or to the one before if back is set,
+   * without latching. The parameters are those of findEntry().
+   * @return	False if a node changed on the way, the caller starts over
+   */
+	bool stepEntry(PageId & leafId, std::uint64_t & version, int & pos, const bool back,
+	               const std::uint64_t treeVersion, int & dirKey, PageId & pageNo, bool & found);
+
+  /**
+   * Collect the directory entries from the first one not below lowKey up to the first one above highKey, for
+   * callers holding the tree latch.
+   */
+	void entriesExclusive(const int lowKey, const int highKey, std::vector<int> & dirKeys,
+	                      std::vector<PageId> & pages);
+
+  /**
+   * Take the latch of a directory leaf found by findEntry() if it is still at version and the tree latch at
+   * treeVersion.
+   */
+	bool latchLeaf(const PageId leafId, const std::uint64_t version, const std::uint64_t treeVersion);
+
+  /**
+   * Decode the entries of a packed leaf, the record ids as ( page_number << 16 | slot_number ).
+   */
+	void readLeaf(const PageId pageNo, std::vector<int> & keys, std::vector<std::uint64_t> & vals);
+
+  /**
+   * Encode n entries into a packed leaf if they fit into it.
+   * @return	False if they do not fit, the leaf is not changed then
+   */
+	bool writeLeaf(const PageId pageNo, const int* keys, const std::uint64_t* vals, const std::size_t n);
+
+  /**
+   * Encode n entries into a new packed leaf, they have to fit into it.
+   * @return	Page number of the leaf
+   */
+	PageId newLeaf(const int* keys, const std::uint64_t* vals, const std::size_t n);
+
+  /**
+   * Store the entries of the packed leaf of the directory entry <dirKey, pageNo> that do not fit into one leaf
+   * any more in several ones, and add the directory entries of the new leaves.
+   */
+	void splitLeaf(const int dirKey, const PageId pageNo, const std::vector<int> & keys,
+	               const std::vector<std::uint64_t> & vals);
+
+  /**
+   * Find the first packed leaf the rest of the scan of a cursor may return entries of, from the bound of the
+   * scan or the last key returned, and load it, see loadLeaf().
+   * @return	False if the scan has no more entries
+   */
+	bool findPlace(IndexCursor & cursor);
+
+  /**
+   * Move a cursor to the next packed leaf of its scan and load it. If the directory leaf of the cursor changed
+   * meanwhile the cursor finds its place again instead.
+   * @return	False if the scan has no more entries
+   */
+	bool nextLeaf(IndexCursor & cursor);
+
+  /**
+   * Decode the packed leaf pageNo of the directory entry of a cursor and keep the entries the scan still has to
+   * return in the cursor.
+   * @param past	Set to true if the leaf is beyond the range of the scan, and so are all leaves after it
+   * @return	False if the directory leaf changed, nothing is loaded then
+   */
+	bool loadLeaf(IndexCursor & cursor, const PageId pageNo, bool & past);
+
+  /**
+   * Next record id of a scan, see scanNext().
+   */
+	bool nextRid(IndexCursor & cursor, RecordId & outRid);
+};
+
+}
@@ -0,0 +1,735 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "posting.h"
+#include "varint.h"
+#include <algorithm>
+#include <vector>
+
+namespace badgerdb
+{
+
+/**
+ * Record id of the directory entries, every key has a single one.
+ */
+static const RecordId DIRECTORYRID = {0, 0};
+
+/**
+ * Encode the leading values of sorted vals that fit into capacity bytes, the first one as itself and every
+ * further one as the difference to the one before, as varints.
+ * @return	Number of values encoded
+ */
+static std::size_t packRids(const std::uint64_t* vals, const std::size_t n, unsigned char* out, const int capacity) {
+	int bytes = 0;
+	std::size_t i = 0;
+	for(; i < n; i ++) {
+		const std::uint64_t delta = (i == 0) ? vals[0] : vals[i] - vals[i - 1];
+		if(bytes + varintSize(delta) > capacity) break;
+		bytes += putVarint(out + bytes, delta);
+	}
+	return i;
+}
+
+/**
+ * Decode n values encoded by packRids from a buffer of capacity bytes and append them to vals. Decoding stops at
+ * the end of the buffer, so a reader that raced a writer decodes garbage at worst, which it then throws away.
+ */
+static void unpackRids(const unsigned char* in, const std::size_t n, const int capacity,
+                       std::vector<std::uint64_t> & vals) {
+	const unsigned char* end = in + capacity;
+	std::uint64_t val = 0;
+	for(std::size_t i = 0; i < n && in < end; i ++) {
+		val += getVarint(in, end);
+		vals.push_back(val);
+	}
+}
+
+/**
+ * Number of bytes of the record ids of an overflow page.
+ */
+static const int POSTINGPAGESIZE = sizeof(PostingPage::data);
+
+// -----------------------------------------------------------------------------
+// PostingCore::PostingCore -- Constructor
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+PostingCore<Traits>::PostingCore(BTreeIndex* index) : BTreeCore<Traits>(index) {
+	static_assert(sizeof(PostingHead) <= MAXPAYLOADSIZE, "posting list head does not fit into a payload");
+	static_assert(sizeof(PostingPage) <= Page::SIZE, "overflow page does not fit into a page");
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::buildIndex
+// -----------------------------------------------------------------------------
+
+/*
+The <key, rid> pairs of the relation are sorted as for any index, so the record ids of a key come one after the
+other and in order. The posting list of a key is written when its run ends, and its directory entry, with the head
+of the list as payload, is handed to a second sorter in key order, which the bulk loader streams.
+*/
+
+template <class Traits>
+void PostingCore<Traits>::buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions) {
+	BTreeIndex* index = this->index;
+	ExternalSorter<RIDKeyPair<KeyType> > sorter(index->bufMgr, index->file->filename() + ".sort",
+	                                            buildOptions.sortMemPages);
+	this->sortRelation(relationName, buildOptions, sorter);
+
+	ExternalSorter<RIDKeyPayload<KeyType> > heads(index->bufMgr, index->file->filename() + ".keys",
+	                                              buildOptions.sortMemPages);
+	std::vector<std::uint64_t> vals;
+	RIDKeyPair<KeyType> entry;
+	bool more = sorter.next(entry);
+	while(more) {
+		const KeyType key = entry.key;
+		vals.clear();
+		do {
+			vals.push_back(ridValue(entry.rid));
+			more = sorter.next(entry);
+		} while(more && !(key != entry.key));
+
+		PostingHead head;
+		writeList(vals.data(), vals.size(), head);
+		RIDKeyPayload<KeyType> dirEntry;
+		dirEntry.set(DIRECTORYRID, key);
+		memset(dirEntry.payload, 0, MAXPAYLOADSIZE);
+		memcpy(dirEntry.payload, &head, sizeof(PostingHead));
+		heads.add(dirEntry);
+	}
+
+	heads.finish();
+	this->bulkLoad(heads, buildOptions.fillFactor);
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::findHead / findHeadExclusive / setHead / latchLeaf
+// -----------------------------------------------------------------------------
+
+/*
+The latch of a directory leaf also covers the overflow pages of the posting lists of its entries, they are only
+written holding it or the tree latch. A reader takes the version of the leaf latch when it finds the entry, and
+validates it along with the tree latch after every overflow page it reads, before it follows the link to the next
+one. A page that was freed and reused for another list or node meanwhile fails the validation as well, since the
+writer freeing it held the leaf latch.
+*/
+
+template <class Traits>
+bool PostingCore<Traits>::findHead(const KeyType & key, const std::uint64_t treeVersion, PageId & leafId,
+                                   std::uint64_t & version, int & pos, PostingHead & head, bool & found) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	LatchTable & latches = this->index->latches;
+
+	// the leftmost leaf that may hold key ends before it if the separator to its right equals key
+	found = false;
+	version = 0;
+	if(!this->findLeafOptimistic(key, true, treeVersion, leafId, version)) return false;
+	if(leafId == 0) return latches.tree().validate(treeVersion);
+	while(true) {
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int len = this->lengthOf(leaf);
+		pos = Traits::lowerBound(this->keysOf(leaf), len, key);
+		if(pos < len) {
+			found = !(key < this->keysOf(leaf)[pos]);
+			if(found) {
+				memcpy(&head, this->payloadsOf(leaf) + pos * sizeof(PostingHead), sizeof(PostingHead));
+			}
+		}
+		const PageId rightId = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, leafId, false);
+		if(!this->validate(leafId, version, treeVersion)) return false;
+		if(pos < len || rightId == 0) return true;
+
+		const std::uint64_t rightVersion = latches.node(rightId).readLock();
+		if(!latches.node(leafId).validate(version)) return false;
+		leafId = rightId;
+		version = rightVersion;
+	}
+}
+
+template <class Traits>
+bool PostingCore<Traits>::findHeadExclusive(const KeyType & key, PageId & leafId, int & pos, PostingHead & head) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	leafId = this->findLeaf(key, true);
+	while(leafId != 0) {
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const int len = leaf->keyArrLength;
+		pos = Traits::lowerBound(this->keysOf(leaf), len, key);
+		if(pos < len) {
+			const bool found = !(key < this->keysOf(leaf)[pos]);
+			if(found) {
+				memcpy(&head, this->payloadsOf(leaf) + pos * sizeof(PostingHead), sizeof(PostingHead));
+			}
+			bufMgr->unPinPage(file, leafId, false);
+			return found;
+		}
+		const PageId rightId = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, leafId, false);
+		leafId = rightId;
+	}
+	return false;
+}
+
+template <class Traits>
+void PostingCore<Traits>::setHead(const PageId leafId, const int pos, const PostingHead & head) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	// the entry keeps its place, cursors on the leaf find it again like after any change
+	Page* page;
+	bufMgr->readPage(file, leafId, page);
+	memcpy(this->payloadsOf((LeafNode*)page) + pos * sizeof(PostingHead), &head, sizeof(PostingHead));
+	bufMgr->unPinPage(file, leafId, true);
+}
+
+template <class Traits>
+bool PostingCore<Traits>::latchLeaf(const PageId leafId, const std::uint64_t version,
+                                    const std::uint64_t treeVersion) {
+	LatchTable & latches = this->index->latches;
+	if(!latches.node(leafId).tryUpgrade(version)) {
+		return false;
+	}
+	if(!latches.tree().validate(treeVersion)) {
+		latches.node(leafId).unlock();
+		return false;
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::readList / readRids
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool PostingCore<Traits>::readList(const PostingHead & head, const PageId leafId, const std::uint64_t version,
+                                   const std::uint64_t treeVersion, std::vector<std::uint64_t> & vals) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	if(head.firstPage == 0) {
+		unpackRids(head.data, head.count, POSTINGINLINESIZE, vals);
+		return true;
+	}
+	PageId pageNo = head.firstPage;
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		PostingPage* posting = (PostingPage*)page;
+		unpackRids(posting->data, posting->count, POSTINGPAGESIZE, vals);
+		const PageId nextId = posting->nextPage;
+		bufMgr->unPinPage(file, pageNo, false);
+		if(!this->validate(leafId, version, treeVersion)) return false;
+		pageNo = nextId;
+	}
+	return true;
+}
+
+template <class Traits>
+void PostingCore<Traits>::readRids(const KeyType & key, const bool reverse, std::vector<RecordId> & rids,
+                                   IndexCursor* cursor) {
+	LatchTable & latches = this->index->latches;
+	std::vector<std::uint64_t> vals;
+	while(true) {
+		vals.clear();
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		PageId leafId;
+		std::uint64_t version;
+		int pos;
+		PostingHead head;
+		bool found;
+		if(!findHead(key, treeVersion, leafId, version, pos, head, found)) continue;
+		if(found && !readList(head, leafId, version, treeVersion, vals)) continue;
+		if(cursor != NULL) {
+			cursor->postingLeaf = leafId;
+			cursor->postingVersion = version;
+			cursor->postingTreeVersion = treeVersion;
+		}
+		break;
+	}
+
+	const std::size_t n = vals.size();
+	rids.resize(n);
+	for(std::size_t i = 0; i < n; i ++) {
+		rids[i] = ridOf(vals[reverse ? n - 1 - i : i]);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::writeList / writeChain / freeChain
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void PostingCore<Traits>::writeList(const std::uint64_t* vals, const std::size_t n, PostingHead & head) {
+	memset(&head, 0, sizeof(PostingHead));
+	head.count = n;
+	if(packRids(vals, n, head.data, POSTINGINLINESIZE) < n) {
+		memset(head.data, 0, POSTINGINLINESIZE);
+		head.firstPage = writeChain(vals, n, 0);
+	}
+}
+
+template <class Traits>
+PageId PostingCore<Traits>::writeChain(const std::uint64_t* vals, const std::size_t n, const PageId nextPage) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	PageId firstId = 0;
+	PostingPage* prev = NULL;
+	PageId prevId = 0;
+	std::size_t done = 0;
+	while(done < n) {
+		PageId pageNo;
+		Page* page;
+		this->allocNode(pageNo, page);
+		PostingPage* posting = (PostingPage*)page;
+		memset(posting, 0, sizeof(PostingPage));
+		posting->count = packRids(vals + done, n - done, posting->data, POSTINGPAGESIZE);
+		done += posting->count;
+
+		if(prev != NULL) {
+			prev->nextPage = pageNo;
+			bufMgr->unPinPage(file, prevId, true);
+		} else {
+			firstId = pageNo;
+		}
+		prev = posting;
+		prevId = pageNo;
+	}
+	prev->nextPage = nextPage;
+	bufMgr->unPinPage(file, prevId, true);
+	return firstId;
+}
+
+template <class Traits>
+void PostingCore<Traits>::freeChain(PageId pageNo) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	while(pageNo != 0) {
+		Page* page;
+		bufMgr->readPage(file, pageNo, page);
+		const PageId nextId = ((PostingPage*)page)->nextPage;
+		bufMgr->unPinPage(file, pageNo, false);
+		this->freeNode(pageNo);
+		pageNo = nextId;
+	}
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::addRid / removeRid
+// -----------------------------------------------------------------------------
+
+/*
+A record id goes to the first overflow page whose run ends at or after it, or to the last page, which keeps the
+runs of the chain in order. Only that page is decoded and encoded again. A page that overflows keeps the lower half
+of its run and a new page after it takes the upper half, so inserts in record id order fill the pages, others leave
+them half full. A run that loses a record id never needs more bytes, a page that loses its last one is unlinked.
+*/
+
+template <class Traits>
+void PostingCore<Traits>::addRid(PostingHead & head, const std::uint64_t val) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	std::vector<std::uint64_t> vals;
+
+	if(head.firstPage == 0) {
+		unpackRids(head.data, head.count, POSTINGINLINESIZE, vals);
+		vals.insert(std::upper_bound(vals.begin(), vals.end(), val), val);
+		writeList(vals.data(), vals.size(), head);
+		return;
+	}
+
+	PageId pageNo = head.firstPage;
+	Page* page;
+	PostingPage* posting;
+	while(true) {
+		bufMgr->readPage(file, pageNo, page);
+		posting = (PostingPage*)page;
+		vals.clear();
+		unpackRids(posting->data, posting->count, POSTINGPAGESIZE, vals);
+		if(posting->nextPage == 0 || val <= vals.back()) break;
+		const PageId nextId = posting->nextPage;
+		bufMgr->unPinPage(file, pageNo, false);
+		pageNo = nextId;
+	}
+
+	vals.insert(std::upper_bound(vals.begin(), vals.end(), val), val);
+	std::size_t n = packRids(vals.data(), vals.size(), posting->data, POSTINGPAGESIZE);
+	if(n < vals.size()) {
+		n = vals.size() / 2;
+		memset(posting->data, 0, POSTINGPAGESIZE);
+		packRids(vals.data(), n, posting->data, POSTINGPAGESIZE);
+		posting->nextPage = writeChain(vals.data() + n, vals.size() - n, posting->nextPage);
+	}
+	posting->count = n;
+	bufMgr->unPinPage(file, pageNo, true);
+	head.count ++;
+}
+
+template <class Traits>
+bool PostingCore<Traits>::removeRid(PostingHead & head, const std::uint64_t val) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	std::vector<std::uint64_t> vals;
+
+	if(head.firstPage == 0) {
+		unpackRids(head.data, head.count, POSTINGINLINESIZE, vals);
+		std::vector<std::uint64_t>::iterator it = std::lower_bound(vals.begin(), vals.end(), val);
+		if(it == vals.end() || *it != val) return false;
+		vals.erase(it);
+		writeList(vals.data(), vals.size(), head);
+		return true;
+	}
+
+	PageId prevId = 0;
+	PageId pageNo = head.firstPage;
+	Page* page;
+	PostingPage* posting;
+	while(true) {
+		bufMgr->readPage(file, pageNo, page);
+		posting = (PostingPage*)page;
+		vals.clear();
+		unpackRids(posting->data, posting->count, POSTINGPAGESIZE, vals);
+		if(posting->nextPage == 0 || val <= vals.back()) break;
+		const PageId nextId = posting->nextPage;
+		bufMgr->unPinPage(file, pageNo, false);
+		prevId = pageNo;
+		pageNo = nextId;
+	}
+
+	std::vector<std::uint64_t>::iterator it = std::lower_bound(vals.begin(), vals.end(), val);
+	if(it == vals.end() || *it != val) {
+		bufMgr->unPinPage(file, pageNo, false);
+		return false;
+	}
+	vals.erase(it);
+	head.count --;
+
+	if(vals.empty()) {
+		const PageId nextId = posting->nextPage;
+		bufMgr->unPinPage(file, pageNo, false);
+		if(prevId == 0) {
+			head.firstPage = nextId;
+		} else {
+			Page* prevPage;
+			bufMgr->readPage(file, prevId, prevPage);
+			((PostingPage*)prevPage)->nextPage = nextId;
+			bufMgr->unPinPage(file, prevId, true);
+		}
+		this->freeNode(pageNo);
+	} else {
+		memset(posting->data, 0, POSTINGPAGESIZE);
+		posting->count = packRids(vals.data(), vals.size(), posting->data, POSTINGPAGESIZE);
+		bufMgr->unPinPage(file, pageNo, true);
+	}
+
+	// a list left on one page that fits into the head again moves back into it, every record id takes a byte at least
+	if(head.firstPage != 0 && head.count <= (std::uint32_t)POSTINGINLINESIZE) {
+		const PageId firstId = head.firstPage;
+		bufMgr->readPage(file, firstId, page);
+		posting = (PostingPage*)page;
+		unsigned char data[POSTINGINLINESIZE];
+		memset(data, 0, POSTINGINLINESIZE);
+		bool fits = false;
+		if(posting->nextPage == 0) {
+			vals.clear();
+			unpackRids(posting->data, posting->count, POSTINGPAGESIZE, vals);
+			fits = (packRids(vals.data(), vals.size(), data, POSTINGINLINESIZE) == vals.size());
+		}
+		bufMgr->unPinPage(file, firstId, false);
+		if(fits) {
+			memcpy(head.data, data, POSTINGINLINESIZE);
+			head.firstPage = 0;
+			this->freeNode(firstId);
+		}
+	}
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::insertEntry
+// -----------------------------------------------------------------------------
+
+/*
+A record id of a key that is in the directory already is added holding only the latch of the leaf of its entry,
+like an insert into a leaf with a free slot. The first record id of a key goes into the head of a new directory
+entry, inserted like an entry of any index, and the directory entry of the last one is removed like one; the
+directory only runs alone under the tree latch when it gets a new root or merges nodes.
+*/
+
+template <class Traits>
+void PostingCore<Traits>::insertEntry(const void* keyParm, const RecordId rid, const void* /*payload*/) {
+	LatchTable & latches = this->index->latches;
+	KeyType key;
+	Traits::load(keyParm, key);
+	const std::uint64_t val = ridValue(rid);
+
+	PageId leafId;
+	int pos;
+	PostingHead head;
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		std::uint64_t version;
+		bool found;
+		if(!findHead(key, treeVersion, leafId, version, pos, head, found)) continue;
+		if(!found) {
+			// a list of one record id fits into the head, so a new key allocates no overflow page
+			bool present;
+			writeList(&val, 1, head);
+			if(!this->insertOptimistic(key, DIRECTORYRID, &head, true, present)) break;
+			if(present) continue;
+			return;
+		}
+		if(!latchLeaf(leafId, version, treeVersion)) continue;
+		try {
+			addRid(head, val);
+			setHead(leafId, pos, head);
+		} catch(...) {
+			latches.node(leafId).unlock();
+			throw;
+		}
+		latches.node(leafId).unlock();
+		return;
+	}
+
+	// the directory is empty or its root splits
+	TreeLock lock(latches);
+	if(findHeadExclusive(key, leafId, pos, head)) {
+		addRid(head, val);
+		setHead(leafId, pos, head);
+		return;
+	}
+	writeList(&val, 1, head);
+	this->insertExclusive(key, DIRECTORYRID, &head);
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::deleteEntry
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool PostingCore<Traits>::deleteEntry(const void* keyParm, const RecordId rid) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+	LatchTable & latches = this->index->latches;
+	KeyType key;
+	Traits::load(keyParm, key);
+	const std::uint64_t val = ridValue(rid);
+
+	PageId leafId;
+	int pos;
+	PostingHead head;
+	while(true) {
+		const std::uint64_t treeVersion = latches.tree().readLock();
+		std::uint64_t version;
+		bool found;
+		if(!findHead(key, treeVersion, leafId, version, pos, head, found)) continue;
+		if(!found) return false;
+		if(!latchLeaf(leafId, version, treeVersion)) continue;
+
+		// removing the directory entry of the last record id must leave the leaf at least half full
+		bool removed = false;
+		bool underflow = false;
+		try {
+			Page* page;
+			bufMgr->readPage(file, leafId, page);
+			const int len = ((LeafNode*)page)->keyArrLength;
+			bufMgr->unPinPage(file, leafId, false);
+			underflow = (head.count <= 1 && len - 1 < this->index->leafOccupancy / 2);
+			if(!underflow) {
+				removed = removeRid(head, val);
+			}
+			if(removed && head.count == 0) {
+				bufMgr->readPage(file, leafId, page);
+				this->removeFromLeaf((LeafNode*)page, pos);
+				bufMgr->unPinPage(file, leafId, true);
+			} else if(removed) {
+				setHead(leafId, pos, head);
+			}
+		} catch(...) {
+			latches.node(leafId).unlock();
+			throw;
+		}
+		latches.node(leafId).unlock();
+		if(!underflow) return removed;
+		break;
+	}
+
+	// the directory entry goes and its leaf underflows
+	TreeLock lock(latches);
+	if(!findHeadExclusive(key, leafId, pos, head)) {
+		return false;
+	}
+	if(!removeRid(head, val)) {
+		return false;
+	}
+	if(head.count == 0) {
+		return this->deleteExclusive(key, DIRECTORYRID);
+	}
+	setHead(leafId, pos, head);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::deleteRangeExclusive
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+void PostingCore<Traits>::deleteRangeExclusive(const KeyType & lowKey, const Operator lowOp, const KeyType & highKey,
+                                               const Operator highOp) {
+	BufMgr* bufMgr = this->index->bufMgr;
+	File* file = this->index->file;
+
+	// the overflow pages of the keys in the range go first, the leaves are walked from the first one of the range
+	PageId leafId = this->findLeaf(lowKey, true);
+	bool past = false;
+	while(leafId != 0 && !past) {
+		Page* page;
+		bufMgr->readPage(file, leafId, page);
+		LeafNode* leaf = (LeafNode*)page;
+		const KeyType* keys = this->keysOf(leaf);
+		const PostingHead* heads = (const PostingHead*)this->payloadsOf(leaf);
+		for(int i = 0; i < leaf->keyArrLength && !past; i ++) {
+			const bool below = (lowOp == GTE) ? keys[i] < lowKey : !(lowKey < keys[i]);
+			past = (highOp == LT) ? !(keys[i] < highKey) : highKey < keys[i];
+			if(!below && !past) {
+				freeChain(heads[i].firstPage);
+			}
+		}
+		const PageId rightId = leaf->rightSibPageNo;
+		bufMgr->unPinPage(file, leafId, false);
+		leafId = rightId;
+	}
+	BTreeCore<Traits>::deleteRangeExclusive(lowKey, lowOp, highKey, highOp);
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::startScan
+// -----------------------------------------------------------------------------
+
+/*
+A scan runs over the directory with the BTreeCore cursor and returns the posting list of every key it gets to,
+read when the cursor gets there. A reverse scan returns the keys from the high value down and the record ids of
+every key in descending order. The cursor keeps the list, if the leaf of its entry changes meanwhile the list is
+read again and the scan continues after the last record id it returned.
+*/
+
+template <class Traits>
+bool PostingCore<Traits>::startScan(IndexCursor & cursor, const void* lowVal, const Operator lowOp,
+                                    const void* highVal, const Operator highOp, const bool reverse) {
+	cursor.postingRids.clear();
+	cursor.postingPos = 0;
+	if(!BTreeCore<Traits>::startScan(cursor, lowVal, lowOp, highVal, highOp, reverse)) {
+		return false;
+	}
+	while(cursor.postingRids.empty()) {
+		if(!nextKey(cursor)) {
+			cursor.endScan();
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class Traits>
+bool PostingCore<Traits>::nextKey(IndexCursor & cursor) {
+	RecordId rid;
+	if(!BTreeCore<Traits>::scanNext(cursor, rid, NULL)) {
+		return false;
+	}
+
+	// the head may have changed since the directory scan read it, the list is found again by its key
+	readRids(this->lastKeyOf(cursor), cursor.reverse, cursor.postingRids, &cursor);
+	cursor.postingPos = 0;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::scanNext / scanNextBatch
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+bool PostingCore<Traits>::scanNext(IndexCursor & cursor, RecordId& outRid, void* /*outPayload*/) {
+	return nextRid(cursor, outRid);
+}
+
+template <class Traits>
+std::size_t PostingCore<Traits>::scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids,
+                                               void* /*outPayloads*/) {
+	std::size_t cnt = 0;
+	while(cnt < maxRids && nextRid(cursor, outRids[cnt])) {
+		cnt ++;
+	}
+	return cnt;
+}
+
+template <class Traits>
+bool PostingCore<Traits>::nextRid(IndexCursor & cursor, RecordId & outRid) {
+	// the list is read again, the record ids up to the last one returned are skipped
+	if(!this->validate(cursor.postingLeaf, cursor.postingVersion, cursor.postingTreeVersion)) {
+		std::vector<RecordId> rids;
+		readRids(this->lastKeyOf(cursor), cursor.reverse, rids, &cursor);
+		std::size_t next = 0;
+		if(cursor.postingPos > 0) {
+			const std::uint64_t last = ridValue(cursor.postingRids[cursor.postingPos - 1]);
+			while(next < rids.size()
+			      && (cursor.reverse ? ridValue(rids[next]) >= last : ridValue(rids[next]) <= last)) {
+				next ++;
+			}
+		}
+		cursor.postingRids.swap(rids);
+		cursor.postingPos = next;
+	}
+
+	while(cursor.postingPos >= cursor.postingRids.size()) {
+		if(!nextKey(cursor)) {
+			return false;
+		}
+	}
+	outRid = cursor.postingRids[cursor.postingPos ++];
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// PostingCore::lookup / lookupBatch
+// -----------------------------------------------------------------------------
+
+template <class Traits>
+std::size_t PostingCore<Traits>::lookup(const void* keyParm, std::vector<RecordId> & outRids) {
+	KeyType key;
+	Traits::load(keyParm, key);
+	readRids(key, false, outRids, NULL);
+	return outRids.size();
+}
+
+template <class Traits>
+std::size_t PostingCore<Traits>::lookupBatch(const void* keys, const std::size_t n,
+                                             std::vector<std::vector<RecordId> > & results) {
+	results.resize(n);
+	std::size_t total = 0;
+	for(std::size_t i = 0; i < n; i ++) {
+		KeyType key;
+		Traits::load((const char*)keys + i * sizeof(KeyType), key);
+		readRids(key, false, results[i], NULL);
+		total += results[i].size();
+	}
+	return total;
+}
+
+template class PostingCore<IntKeyTraits>;
+template class PostingCore<BigintKeyTraits>;
+template class PostingCore<UnsignedKeyTraits>;
+template class PostingCore<UbigintKeyTraits>;
+template class PostingCore<StringKeyTraits>;
+template class PostingCore<VarcharKeyTraits>;
+
+}
@@ -0,0 +1,166 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <vector>
+#include "btree_core.h"
+
+namespace badgerdb
+{
+
+/*
+An index with posting lists keeps a B+ tree with one entry per distinct key, the directory. The payload of that
+entry is the head of the posting list of the key, which holds the sorted record ids of all entries with the key
+itself, or, for a longer list, leads to the overflow pages holding them, see PostingHead. The directory is an ordinary BTreeCore tree with unique keys, so it
+is built, searched, rebalanced and scanned by the BTreeCore code, the posting lists are changed in place next to it.
+*/
+
+/**
+ * @brief B+ tree operations for an index with posting lists, for the key types of Traits. A change to a posting
+ * list reads and writes the one overflow page it touches, holding the latch of the leaf of its directory entry.
+ */
+template <class Traits>
+class PostingCore : public BTreeCore<Traits> {
+
+ public:
+
+	typedef typename Traits::KeyType KeyType;
+	typedef typename Traits::LeafNode LeafNode;
+
+  /**
+   * Constructor of PostingCore class. The directory has the node occupancies of any BTreeCore tree.
+   * @param index	Index the tree belongs to
+   */
+	PostingCore(BTreeIndex* index);
+
+  /**
+   * Sort the <key, rid> pairs of the base relation, write the posting list of every key and bulk load the
+   * directory with their heads.
+   */
+	void buildIndex(const std::string & relationName, const IndexBuildOptions & buildOptions);
+
+  /**
+   * Add rid to the posting list of key, creating the directory entry of a new key. The payload is ignored.
+   */
+	void insertEntry(const void* key, const RecordId rid, const void* payload);
+
+  /**
+   * Remove rid from the posting list of key, and the directory entry once the list is empty.
+   */
+	bool deleteEntry(const void* key, const RecordId rid);
+
+	bool startScan(IndexCursor & cursor, const void* lowVal, const Operator lowOp,
+	               const void* highVal, const Operator highOp, const bool reverse);
+
+  /**
+   * Return the next record id of the posting list of the current key, moving on to the next key of the
+   * directory when it is used up. The payload is not returned.
+   */
+	bool scanNext(IndexCursor & cursor, RecordId& outRid, void* outPayload);
+
+	std::size_t scanNextBatch(IndexCursor & cursor, RecordId* outRids, const std::size_t maxRids, void* outPayloads);
+
+	std::size_t lookup(const void* key, std::vector<RecordId> & outRids);
+
+	std::size_t lookupBatch(const void* keys, const std::size_t n, std::vector<std::vector<RecordId> > & results);
+
+ protected:
+
+  /**
+   * Free the overflow pages of the keys in the range, then remove their directory entries.
+   */
+	void deleteRangeExclusive(const KeyType & lowKey, const Operator lowOp, const KeyType & highKey,
+	                          const Operator highOp);
+
+ private:
+
+  /**
+   * Find the directory entry of key without latching, see BTreeCore::findLeafOptimistic().
+   * @param treeVersion	Version of the tree latch taken by the caller
+   * @param leafId				Set to the leaf holding the entry
+   * @param version				Set to the version of the latch of the leaf when the entry was read
+   * @param pos						Set to the position of the entry in the leaf
+   * @param head					Set to the payload of the entry, the head of the posting list of key
+   * @param found					Set to false if key is not in the index
+   * @return	False if a node changed on the way, the caller starts over
+   */
+	bool findHead(const KeyType & key, const std::uint64_t treeVersion, PageId & leafId, std::uint64_t & version,
+	              int & pos, PostingHead & head, bool & found);
+
+  /**
+   * findHead() for callers holding the tree latch.
+   * @return	False if key is not in the index
+   */
+	bool findHeadExclusive(const KeyType & key, PageId & leafId, int & pos, PostingHead & head);
+
+  /**
+   * Write the head of a posting list back to its directory entry. The caller holds the latch of the leaf or the
+   * tree latch.
+   */
+	void setHead(const PageId leafId, const int pos, const PostingHead & head);
+
+  /**
+   * Take the latch of a leaf found by findHead() if it is still at version and the tree latch at treeVersion.
+   */
+	bool latchLeaf(const PageId leafId, const std::uint64_t version, const std::uint64_t treeVersion);
+
+  /**
+   * Append the record ids of a posting list, as ( page_number << 16 | slot_number ), to vals. The latch of the
+   * leaf of the directory entry is validated after every overflow page.
+   * @return	False if the list changed while it was read, the caller starts over
+   */
+	bool readList(const PostingHead & head, const PageId leafId, const std::uint64_t version,
+	              const std::uint64_t treeVersion, std::vector<std::uint64_t> & vals);
+
+  /**
+   * Fill rids with the record ids of the posting list of key, in descending order if reverse is set.
+   * @param cursor	If given, keeps where the list was read, see IndexCursor::postingLeaf
+   */
+	void readRids(const KeyType & key, const bool reverse, std::vector<RecordId> & rids, IndexCursor* cursor);
+
+  /**
+   * Store sorted record ids as a new posting list, in the head if they fit, else in a chain of overflow pages.
+   */
+	void writeList(const std::uint64_t* vals, const std::size_t n, PostingHead & head);
+
+  /**
+   * Write sorted record ids to new overflow pages, each one filled as far as it goes.
+   * @param nextPage	Page the last new page links to
+   * @return	First new page
+   */
+	PageId writeChain(const std::uint64_t* vals, const std::size_t n, const PageId nextPage);
+
+  /**
+   * Put the overflow pages of a chain on the free list.
+   */
+	void freeChain(PageId pageNo);
+
+  /**
+   * Add a record id to a posting list. The head is updated, not written back.
+   */
+	void addRid(PostingHead & head, const std::uint64_t val);
+
+  /**
+   * Remove a record id from a posting list. The head is updated, not written back.
+   * @return	False if the list does not hold the record id
+   */
+	bool removeRid(PostingHead & head, const std::uint64_t val);
+
+  /**
+   * Load the posting list of the next key of the directory scan of a cursor.
+   * @return	False if the scan has no more keys
+   */
+	bool nextKey(IndexCursor & cursor);
+
+  /**
+   * Next record id of a scan, see scanNext().
+   */
+	bool nextRid(IndexCursor & cursor, RecordId & outRid);
+};
+
+}
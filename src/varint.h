@@ -0,0 +1,88 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+
+namespace badgerdb
+{
+
+/*
+Record ids stored in compressed form, in posting lists and packed leaves, are encoded as differences of the number
+( page_number << 16 | slot_number ) to the record id before. Differences are stored as varints, 7 bits per byte
+with the high bit set on all but the last byte, so record ids of nearby records take a byte or two.
+*/
+
+/**
+ * Record id as the number its differences are taken of.
+ */
+inline std::uint64_t ridValue(const RecordId & rid) {
+	return ((std::uint64_t)rid.page_number << 16) | rid.slot_number;
+}
+
+inline RecordId ridOf(const std::uint64_t val) {
+	RecordId rid;
+	rid.page_number = (PageId)(val >> 16);
+	rid.slot_number = (SlotId)(val & 0xffff);
+	return rid;
+}
+
+/**
+ * Number of bytes of a value as varint.
+ */
+inline int varintSize(std::uint64_t val) {
+	int size = 1;
+	while(val >= 0x80) {
+		val >>= 7;
+		size ++;
+	}
+	return size;
+}
+
+/**
+ * Write a value as varint.
+ * @return	Number of bytes written
+ */
+inline int putVarint(unsigned char* out, std::uint64_t val) {
+	int bytes = 0;
+	while(val >= 0x80) {
+		out[bytes ++] = (unsigned char)(val | 0x80);
+		val >>= 7;
+	}
+	out[bytes ++] = (unsigned char)val;
+	return bytes;
+}
+
+/**
+ * Read a varint at in, which must be before end, and move in past it. Reading stops at end, so a reader that
+ * raced a writer decodes garbage at worst, which it then throws away.
+ */
+inline std::uint64_t getVarint(const unsigned char* & in, const unsigned char* end) {
+	std::uint64_t val = 0;
+	int shift = 0;
+	while((*in & 0x80) && in + 1 < end && shift < 56) {
+		val |= (std::uint64_t)(*in ++ & 0x7f) << shift;
+		shift += 7;
+	}
+	val |= (std::uint64_t)(*in ++) << shift;
+	return val;
+}
+
+/**
+ * Map a signed difference to an unsigned one, small magnitudes to small values, so that it takes few varint bytes.
+ */
+inline std::uint64_t zigzag(const std::int64_t val) {
+	return val < 0 ? ~((std::uint64_t)val << 1) : (std::uint64_t)val << 1;
+}
+
+inline std::int64_t unzigzag(const std::uint64_t val) {
+	return (val & 1) ? (std::int64_t)~(val >> 1) : (std::int64_t)(val >> 1);
+}
+
+}